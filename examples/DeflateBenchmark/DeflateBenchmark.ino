@@ -0,0 +1,78 @@
+//
+// Compression ratio and CPU time of permessage-deflate on a JSON telemetry stream
+//
+// Sends the same 200 telemetry messages through the compressor and back through the
+// inflater for every window size, with and without context takeover, and prints the
+// compressed size in percent of the original and the microseconds per message.
+// Every message is checked after the round trip. No network is needed, the results
+// go to Serial.
+//
+#include <Arduino.h>
+#include <AsyncWebDeflate.h>
+
+#define MESSAGES 200
+
+static const uint8_t windowBits[] = { 9, 10, 12, 15 };
+
+static size_t telemetry(char * buf, size_t cap, size_t n) {
+  //slow changing values like a sensor node would send them
+  return snprintf(buf, cap,
+    "{\"device\":\"node-07\",\"seq\":%u,\"uptime\":%lu,\"temperature\":%d.%u,\"humidity\":%u,"
+    "\"pressure\":%u,\"rssi\":%d,\"heap\":%u,\"relays\":[%u,%u,%u,%u],\"status\":\"%s\"}",
+    (unsigned)n, 3600UL + n * 5, 21 + (int)(n % 7) / 3, (unsigned)(n * 3) % 10, 40 + (unsigned)(n % 11),
+    1013 - (unsigned)(n % 4), -60 - (int)(n % 9), 41000 - (unsigned)(n * 37) % 900,
+    (unsigned)(n / 10) & 1, (unsigned)(n / 25) & 1, 0u, 1u, (n % 50) ? "ok" : "calibrating");
+}
+
+static void run(uint8_t bits, bool noContextTakeover) {
+  AsyncWebDeflater deflater(bits, noContextTakeover);
+  AsyncWebInflater inflater(bits, noContextTakeover, 1024);
+  if (!noContextTakeover && !deflater.contextTakeover()) {
+    Serial.printf("window %2u  context takeover     no memory for the window\n", bits);
+    return;
+  }
+  char message[256];
+  uint8_t compressed[512];
+  size_t plainBytes = 0, compressedBytes = 0, uncompressed = 0;
+  uint32_t deflateTime = 0, inflateTime = 0;
+  for (size_t n = 0; n < MESSAGES; n++) {
+    size_t len = telemetry(message, sizeof(message), n);
+    plainBytes += len;
+    uint32_t start = micros();
+    size_t clen = deflater.compress((const uint8_t *)message, len, compressed, len);
+    deflateTime += micros() - start;
+    if (!clen) {
+      //larger than the message, it would go out uncompressed
+      compressedBytes += len;
+      uncompressed++;
+      continue;
+    }
+    compressedBytes += clen;
+    start = micros();
+    bool ok = inflater.decompress(compressed, clen);
+    inflateTime += micros() - start;
+    if (!ok || inflater.length() != len || memcmp(inflater.data(), message, len)) {
+      Serial.printf("window %2u: message %u differs after the round trip\n", bits, (unsigned)n);
+      return;
+    }
+    inflater.reset();
+  }
+  Serial.printf("window %2u  %-20s %5.1f%%  deflate %4lu us  inflate %4lu us  sent plain %u\n",
+    bits, noContextTakeover ? "no_context_takeover" : "context takeover",
+    100.0 * compressedBytes / plainBytes, (unsigned long)(deflateTime / MESSAGES),
+    (unsigned long)(inflateTime / MESSAGES), (unsigned)uncompressed);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  char sample[256];
+  Serial.printf("%u messages of about %u bytes\n", MESSAGES, (unsigned)telemetry(sample, sizeof(sample), 0));
+  for (size_t i = 0; i < sizeof(windowBits); i++) {
+    run(windowBits[i], true);
+    run(windowBits[i], false);
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,91 @@
+//
+// Heap use and CPU time of AsyncEventSource broadcasts against the number of clients
+//
+// Connect some clients to /events, for example
+//
+//   for i in $(seq 8); do curl -sN http://<ip>/events > /dev/null & done
+//
+// then GET /bench?sends=50&len=200. The loop sends that many events of len bytes to all
+// clients and prints on Serial the microseconds per send(), the heap held by the queued
+// events right after the burst and the heap once the clients have received them.
+// Repeat with more clients to see how the cost grows.
+//
+#include <Arduino.h>
+#ifdef ESP32
+#include <WiFi.h>
+#include <AsyncTCP.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#endif
+#include <ESPAsyncWebServer.h>
+
+const char* ssid = "YOUR_SSID";
+const char* password = "YOUR_PASSWORD";
+
+AsyncWebServer server(80);
+AsyncEventSource events("/events");
+
+static volatile size_t pendingSends = 0;
+static volatile size_t pendingLen = 0;
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+  if (WiFi.waitForConnectResult() != WL_CONNECTED) {
+    Serial.printf("WiFi Failed!\n");
+    return;
+  }
+  Serial.print("IP Address: ");
+  Serial.println(WiFi.localIP());
+
+  //a burst must not be cut by the queue limit of the clients
+  events.queueLimit(64 * 1024);
+  server.addHandler(&events);
+
+  server.on("/bench", HTTP_GET, [](AsyncWebServerRequest *request) {
+    pendingLen = request->hasParam("len") ? request->getParam("len")->value().toInt() : 200;
+    pendingSends = request->hasParam("sends") ? request->getParam("sends")->value().toInt() : 50;
+    request->send(200, "text/plain", "started, see Serial\n");
+  });
+
+  server.begin();
+}
+
+void loop() {
+  if (!pendingSends)
+    return;
+  size_t sends = pendingSends;
+  size_t len = pendingLen;
+  pendingSends = 0;
+
+  String message;
+  message.reserve(len);
+  for (size_t i = 0; i < len; i++)
+    message += (char)('a' + i % 26);
+
+  size_t clients = events.count();
+  uint32_t dropped = events.droppedEvents();
+  uint32_t heapBefore = ESP.getFreeHeap();
+  uint32_t elapsed = 0;
+  for (size_t i = 0; i < sends; i++) {
+    uint32_t start = micros();
+    events.send(message.c_str(), "bench", 0);
+    elapsed += micros() - start;
+  }
+  uint32_t heapAfter = ESP.getFreeHeap();
+
+  //wait until the clients got everything, at most 10 seconds
+  uint32_t waitStart = millis();
+  while (ESP.getFreeHeap() < heapBefore && millis() - waitStart < 10000)
+    delay(50);
+
+  Serial.printf("%u clients, %u events of %u bytes: %lu us per send(), %lu us per client\n",
+    (unsigned)clients, (unsigned)sends, (unsigned)len, (unsigned long)(elapsed / sends),
+    (unsigned long)(clients ? elapsed / sends / clients : 0));
+  Serial.printf("  heap held after the burst %ld bytes (%ld per event), %ld after %lu ms, %u dropped\n",
+    (long)heapBefore - (long)heapAfter, ((long)heapBefore - (long)heapAfter) / (long)sends,
+    (long)heapBefore - (long)ESP.getFreeHeap(), (unsigned long)(millis() - waitStart),
+    (unsigned)(events.droppedEvents() - dropped));
+}
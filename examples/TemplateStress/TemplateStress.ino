@@ -0,0 +1,76 @@
+//
+// Stress test for template processing with long substituted values
+//
+// GET /stress?count=2000&len=1500 renders count lines "[<value>]\n" where value n is
+// len times the letter 'a' + n % 26. Every value is longer than a send buffer, so the
+// look-ahead ring grows and values are split across buffers.
+// The render time is printed on Serial when the connection closes. Check the output with
+//
+//   curl -s "http://<ip>/stress?count=2000&len=1500" > out.txt
+//   python3 -c "print(open('out.txt').read() == ''.join('[' + chr(97 + n % 26) * 1500 + ']\n' for n in range(2000)))"
+//
+#include <Arduino.h>
+#ifdef ESP32
+#include <WiFi.h>
+#include <AsyncTCP.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#endif
+#include <ESPAsyncWebServer.h>
+
+const char* ssid = "YOUR_SSID";
+const char* password = "YOUR_PASSWORD";
+
+static const char line[] = "[%V%]\n";
+
+AsyncWebServer server(80);
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+  if (WiFi.waitForConnectResult() != WL_CONNECTED) {
+    Serial.printf("WiFi Failed!\n");
+    return;
+  }
+  Serial.print("IP Address: ");
+  Serial.println(WiFi.localIP());
+
+  server.on("/stress", HTTP_GET, [](AsyncWebServerRequest *request) {
+    size_t count = request->hasParam("count") ? request->getParam("count")->value().toInt() : 2000;
+    size_t len = request->hasParam("len") ? request->getParam("len")->value().toInt() : 1500;
+    size_t * next = new size_t(0);
+
+    AsyncWebServerResponse *response = request->beginResponse("text/plain", count * (sizeof(line) - 1),
+      [count](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t total = count * (sizeof(line) - 1);
+        size_t n = 0;
+        while (n < maxLen && index + n < total) {
+          buffer[n] = line[(index + n) % (sizeof(line) - 1)];
+          n++;
+        }
+        return n;
+      },
+      [next, len](const String& var) -> String {
+        String value;
+        value.reserve(len);
+        char c = 'a' + (*next)++ % 26;
+        for (size_t i = 0; i < len; i++)
+          value += c;
+        return value;
+      });
+
+    uint32_t start = millis();
+    request->onDisconnect([next, start]() {
+      Serial.printf("%u values in %u ms\n", (unsigned)*next, (unsigned)(millis() - start));
+      delete next;
+    });
+    request->send(response);
+  });
+
+  server.begin();
+}
+
+void loop() {
+}
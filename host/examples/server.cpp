@@ -0,0 +1,82 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+//
+// The library on a Linux host, for load tests, profiling and sanitizer runs
+//
+//   ./aws_host_server [port] [root]
+//
+// serves the files below root (default .) on /, a counter on /events, an echo on /ws,
+// a streamed response on /stream?kb=N and the metrics on /metrics
+//
+#include <ESPAsyncWebServer.h>
+#include <signal.h>
+
+static AsyncEventSource events("/events");
+static AsyncWebSocket ws("/ws");
+
+int main(int argc, char **argv){
+  uint16_t port = argc > 1 ? atoi(argv[1]) : 8080;
+  static FS root(argc > 2 ? argv[2] : ".");
+  signal(SIGPIPE, SIG_IGN);
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  static AsyncWebServer server(port);
+
+  ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
+    if(type != WS_EVT_DATA)
+      return;
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if(info->final && info->index == 0 && info->len == len){
+      if(info->opcode == WS_TEXT)
+        client->text((const char *)data, len);
+      else
+        client->binary(data, len);
+    }
+  });
+  server.addHandler(&ws);
+  server.addHandler(&events);
+  server.addHandler(new AsyncWebMetricsHandler("/metrics"));
+
+  server.on("/stream", HTTP_GET, [](AsyncWebServerRequest *request){
+    size_t kb = request->hasParam("kb") ? request->getParam("kb")->value().toInt() : 64;
+    AsyncResponseStream *response = request->beginResponseStream("text/plain");
+    for(size_t i = 0; i < kb * 16; i++)
+      response->printf("%063u\n", (unsigned)i);
+    request->send(response);
+  });
+
+  server.serveStatic("/", root, "/").setDefaultFile("index.html");
+  server.onNotFound([](AsyncWebServerRequest *request){
+    request->send(404, "text/plain", "Not found");
+  });
+
+  server.begin();
+  printf("listening on port %u\n", port);
+
+  uint32_t n = 0;
+  for(;;){
+    delay(1000);
+    char msg[16];
+    snprintf(msg, sizeof(msg), "%u", (unsigned)n++);
+    events.send(msg, "tick", n);
+  }
+  return 0;
+}
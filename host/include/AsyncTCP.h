@@ -0,0 +1,176 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef HOST_ASYNCTCP_H_
+#define HOST_ASYNCTCP_H_
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+//bytes a client may hold unsent, the default send buffer of lwIP on ESP32
+#ifndef ASYNC_TCP_SND_BUF
+#define ASYNC_TCP_SND_BUF 5744
+#endif
+//largest block handed to onData at once
+#ifndef ASYNC_TCP_RX_BUF
+#define ASYNC_TCP_RX_BUF 16384
+#endif
+#ifndef ASYNC_MAX_ACK_TIME
+#define ASYNC_MAX_ACK_TIME 5000
+#endif
+#ifndef ASYNC_TCP_POLL_INTERVAL
+#define ASYNC_TCP_POLL_INTERVAL 500
+#endif
+
+class AsyncClient;
+class AsyncServer;
+class AsyncTcpLoop;
+
+typedef std::function<void(void*, AsyncClient*)> AcConnectHandler;
+typedef std::function<void(void*, AsyncClient*, size_t len, uint32_t time)> AcAckHandler;
+typedef std::function<void(void*, AsyncClient*, int8_t error)> AcErrorHandler;
+typedef std::function<void(void*, AsyncClient*, void *data, size_t len)> AcDataHandler;
+typedef std::function<void(void*, AsyncClient*, uint32_t time)> AcTimeoutHandler;
+
+//the AsyncClient of AsyncTCP on a non-blocking socket. The callbacks run on the event loop
+//thread like they run on the async_tcp task of the ESP32. An "ack" is reported once the
+//bytes are handed to the kernel. close() and abort() called from another thread are carried
+//out by the event loop, so onDisconnect always runs there
+class AsyncClient {
+  friend class AsyncTcpLoop;
+  protected:
+    int _fd;
+    uint64_t _id;
+    bool _closing;
+    std::mutex _txLock;
+    std::string _tx;
+    size_t _txSent;
+    bool _txArmed;
+    bool _busy;
+    uint32_t _sentAt;
+    uint32_t _rxLastPacket;
+    uint32_t _rxTimeout;
+    uint32_t _ackTimeout;
+
+    AcConnectHandler _discardCb;
+    void *_discardCbArg;
+    AcAckHandler _sentCb;
+    void *_sentCbArg;
+    AcErrorHandler _errorCb;
+    void *_errorCbArg;
+    AcDataHandler _recvCb;
+    void *_recvCbArg;
+    AcTimeoutHandler _timeoutCb;
+    void *_timeoutCbArg;
+    AcConnectHandler _pollCb;
+    void *_pollCbArg;
+
+    int _detach();
+    void _close(bool now);
+    void _abort();
+    void _error(int8_t err);
+    void _flush();
+    void _read(uint8_t *buf, size_t size);
+    void _poll(uint32_t now);
+    IPAddress _address(bool local) const;
+    uint16_t _port(bool local) const;
+
+  public:
+    AsyncClient(int sockfd = -1);
+    ~AsyncClient();
+
+    bool operator==(const AsyncClient &other) const { return _id == other._id; }
+    bool operator!=(const AsyncClient &other) const { return !(*this == other); }
+
+    void close(bool now = false);
+    void stop(){ close(false); }
+    int8_t abort();
+    void free();
+
+    bool canSend(){ return space() > 0; }
+    size_t space();
+    size_t add(const char *data, size_t size, uint8_t apiflags = 0);
+    bool send();
+    size_t write(const char *data);
+    size_t write(const char *data, size_t size, uint8_t apiflags = 0);
+
+    uint8_t state();
+    bool connecting(){ return false; }
+    bool connected();
+    bool disconnecting();
+    bool disconnected();
+    bool freeable(){ return disconnected(); }
+
+    uint16_t getMss(){ return 1460; }
+    uint32_t getRxTimeout(){ return _rxTimeout; }
+    void setRxTimeout(uint32_t timeout){ _rxTimeout = timeout; }
+    uint32_t getAckTimeout(){ return _ackTimeout; }
+    void setAckTimeout(uint32_t timeout){ _ackTimeout = timeout; }
+    void setNoDelay(bool nodelay);
+    bool getNoDelay();
+
+    IPAddress remoteIP(){ return _address(false); }
+    uint16_t remotePort(){ return _port(false); }
+    IPAddress localIP(){ return _address(true); }
+    uint16_t localPort(){ return _port(true); }
+
+    void onDisconnect(AcConnectHandler cb, void *arg = 0);
+    void onAck(AcAckHandler cb, void *arg = 0);
+    void onError(AcErrorHandler cb, void *arg = 0);
+    void onData(AcDataHandler cb, void *arg = 0);
+    void onTimeout(AcTimeoutHandler cb, void *arg = 0);
+    void onPoll(AcConnectHandler cb, void *arg = 0);
+
+    const char *errorToString(int8_t error);
+    const char *stateToString();
+};
+
+//listens on IPv4, accepted connections are handed to onClient on the event loop thread.
+//the event loop starts with the first begin()
+class AsyncServer {
+  friend class AsyncTcpLoop;
+  protected:
+    uint16_t _port;
+    IPAddress _addr;
+    bool _noDelay;
+    int _fd;
+    uint64_t _id;
+    AcConnectHandler _connectCb;
+    void *_connectCbArg;
+
+    void _accept();
+
+  public:
+    AsyncServer(IPAddress addr, uint16_t port);
+    AsyncServer(uint16_t port);
+    ~AsyncServer();
+
+    void onClient(AcConnectHandler cb, void *arg);
+    void begin();
+    void end();
+    void setNoDelay(bool nodelay){ _noDelay = nodelay; }
+    bool getNoDelay(){ return _noDelay; }
+    uint8_t status(){ return _fd >= 0 ? 1 : 0; }
+};
+
+#endif /* HOST_ASYNCTCP_H_ */
@@ -0,0 +1,57 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef HOST_IPADDRESS_H_
+#define HOST_IPADDRESS_H_
+
+#include <stdint.h>
+#include "WString.h"
+#include "Printable.h"
+
+//IPv4 address, stored in network byte order like lwIP does
+class IPAddress: public Printable {
+  private:
+    union {
+      uint8_t bytes[4];
+      uint32_t dword;
+    } _address;
+  public:
+    IPAddress(){ _address.dword = 0; }
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+    IPAddress(uint32_t address){ _address.dword = address; }
+    //uint32_t is unsigned long on the ESP32, so IPAddress(0UL) has to pick this over the pointer
+    IPAddress(unsigned long address){ _address.dword = (uint32_t)address; }
+    IPAddress(const uint8_t *address){ memcpy(_address.bytes, address, 4); }
+
+    bool fromString(const char *address);
+    bool fromString(const String &address){ return fromString(address.c_str()); }
+    operator uint32_t() const { return _address.dword; }
+    bool operator==(const IPAddress &addr) const { return _address.dword == addr._address.dword; }
+    bool operator!=(const IPAddress &addr) const { return !(*this == addr); }
+    bool operator==(const uint8_t *addr) const { return memcmp(addr, _address.bytes, 4) == 0; }
+    uint8_t operator[](int index) const { return _address.bytes[index]; }
+    uint8_t &operator[](int index){ return _address.bytes[index]; }
+    IPAddress &operator=(uint32_t address){ _address.dword = address; return *this; }
+
+    size_t printTo(Print &p) const override;
+    String toString() const;
+};
+
+#endif /* HOST_IPADDRESS_H_ */
@@ -0,0 +1,75 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef HOST_PRINT_H_
+#define HOST_PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+#include "Printable.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+//the Print of the ESP32 Arduino core
+class Print {
+  private:
+    int _writeError;
+    size_t _printNumber(unsigned long long n, uint8_t base, bool negative);
+  protected:
+    void setWriteError(int err = 1){ _writeError = err; }
+  public:
+    Print(): _writeError(0) {}
+    virtual ~Print() {}
+    int getWriteError(){ return _writeError; }
+    void clearWriteError(){ setWriteError(0); }
+
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str){ return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size){ return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite(){ return 0; }
+    virtual void flush() {}
+
+    size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+    size_t print(const __FlashStringHelper *str){ return write(reinterpret_cast<const char *>(str)); }
+    size_t print(const String &str){ return write((const uint8_t *)str.c_str(), str.length()); }
+    size_t print(const char str[]){ return write(str); }
+    size_t print(char c){ return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC){ return _printNumber(n, base, false); }
+    size_t print(int n, int base = DEC){ return print((long long)n, base); }
+    size_t print(unsigned int n, int base = DEC){ return _printNumber(n, base, false); }
+    size_t print(long n, int base = DEC){ return print((long long)n, base); }
+    size_t print(unsigned long n, int base = DEC){ return _printNumber(n, base, false); }
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long long n, int base = DEC){ return _printNumber(n, base, false); }
+    size_t print(double n, int digits = 2);
+    size_t print(const Printable &x){ return x.printTo(*this); }
+
+    size_t println(){ return write("\r\n"); }
+    template<typename T> size_t println(const T &value){ size_t n = print(value); return n + println(); }
+    template<typename T> size_t println(const T &value, int format){ size_t n = print(value, format); return n + println(); }
+};
+
+#endif /* HOST_PRINT_H_ */
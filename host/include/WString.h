@@ -0,0 +1,149 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef HOST_WSTRING_H_
+#define HOST_WSTRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <utility>
+
+//string literals stay in ram on the host, F() only keeps the type of the core
+class __FlashStringHelper;
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal) (FPSTR(string_literal))
+
+//the String of the ESP32 Arduino core, kept in a std::string
+class String {
+  private:
+    std::string _s;
+    static std::string _number(unsigned long long value, unsigned char base, bool negative);
+    static std::string _float(double value, unsigned int decimalPlaces);
+  public:
+    String(const char *cstr = ""): _s(cstr ? cstr : "") {}
+    String(const char *cstr, unsigned int length): _s(cstr ? cstr : "", cstr ? length : 0) {}
+    String(const String &str) = default;
+    String(String &&rval) = default;
+    String(const __FlashStringHelper *str): String(reinterpret_cast<const char *>(str)) {}
+    explicit String(char c): _s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10): _s(_number(value, base, false)) {}
+    explicit String(int value, unsigned char base = 10): _s(_number(value < 0 ? -(long long)value : value, base, value < 0)) {}
+    explicit String(unsigned int value, unsigned char base = 10): _s(_number(value, base, false)) {}
+    explicit String(long value, unsigned char base = 10): _s(_number(value < 0 ? -(long long)value : value, base, value < 0)) {}
+    explicit String(unsigned long value, unsigned char base = 10): _s(_number(value, base, false)) {}
+    explicit String(long long value, unsigned char base = 10): _s(_number(value < 0 ? -(unsigned long long)value : value, base, value < 0)) {}
+    explicit String(unsigned long long value, unsigned char base = 10): _s(_number(value, base, false)) {}
+    explicit String(float value, unsigned int decimalPlaces = 2): _s(_float(value, decimalPlaces)) {}
+    explicit String(double value, unsigned int decimalPlaces = 2): _s(_float(value, decimalPlaces)) {}
+    ~String() {}
+
+    bool reserve(unsigned int size){ _s.reserve(size); return true; }
+    unsigned int length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    void clear(){ _s.clear(); }
+
+    String &operator=(const String &rhs) = default;
+    String &operator=(String &&rval) = default;
+    String &operator=(const char *cstr){ _s = cstr ? cstr : ""; return *this; }
+    String &operator=(const __FlashStringHelper *str){ return *this = reinterpret_cast<const char *>(str); }
+
+    bool concat(const String &str){ _s += str._s; return true; }
+    bool concat(const char *cstr){ if(cstr) _s += cstr; return cstr != NULL; }
+    bool concat(const char *cstr, unsigned int length){ if(cstr) _s.append(cstr, length); return cstr != NULL; }
+    bool concat(const uint8_t *cstr, unsigned int length){ return concat((const char *)cstr, length); }
+    bool concat(char c){ _s += c; return true; }
+    bool concat(unsigned char value){ return concat(String(value)); }
+    bool concat(int value){ return concat(String(value)); }
+    bool concat(unsigned int value){ return concat(String(value)); }
+    bool concat(long value){ return concat(String(value)); }
+    bool concat(unsigned long value){ return concat(String(value)); }
+    bool concat(long long value){ return concat(String(value)); }
+    bool concat(unsigned long long value){ return concat(String(value)); }
+    bool concat(float value){ return concat(String(value)); }
+    bool concat(double value){ return concat(String(value)); }
+    bool concat(const __FlashStringHelper *str){ return concat(reinterpret_cast<const char *>(str)); }
+
+    template<typename T> String &operator+=(const T &rhs){ concat(rhs); return *this; }
+    String &operator+=(const char *cstr){ concat(cstr); return *this; }
+
+    explicit operator bool() const { return true; }
+    int compareTo(const String &s) const { return _s.compare(s._s); }
+    bool equals(const String &s) const { return _s == s._s; }
+    bool equals(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &s) const;
+    bool equalsConstantTime(const String &s) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+    bool operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    bool operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+    bool startsWith(const String &prefix) const { return startsWith(prefix, 0); }
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+    void setCharAt(unsigned int index, char c){ if(index < _s.length()) _s[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index);
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const { getBytes((unsigned char *)buf, bufsize, index); }
+    const char *c_str() const { return _s.c_str(); }
+    char *begin(){ return &_s[0]; }
+    char *end(){ return &_s[0] + _s.length(); }
+    const char *begin() const { return c_str(); }
+    const char *end() const { return c_str() + length(); }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const char *str, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const { return indexOf(str.c_str(), fromIndex); }
+    int lastIndexOf(char ch) const { return lastIndexOf(ch, length() - 1); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String &str) const { return lastIndexOf(str, length() - str.length()); }
+    int lastIndexOf(const String &str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index){ remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+};
+
+template<typename T> inline String operator+(const String &lhs, const T &rhs){ String s(lhs); s += rhs; return s; }
+template<typename T> inline String operator+(String &&lhs, const T &rhs){ lhs += rhs; return std::move(lhs); }
+inline String operator+(const char *lhs, const String &rhs){ String s(lhs); s += rhs; return s; }
+inline String operator+(char lhs, const String &rhs){ String s(lhs); s += rhs; return s; }
+inline String operator+(const __FlashStringHelper *lhs, const String &rhs){ String s(lhs); s += rhs; return s; }
+inline bool operator==(const char *lhs, const String &rhs){ return rhs.equals(lhs); }
+inline bool operator!=(const char *lhs, const String &rhs){ return !rhs.equals(lhs); }
+
+#endif /* HOST_WSTRING_H_ */
@@ -0,0 +1,58 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef HOST_CBUF_H_
+#define HOST_CBUF_H_
+
+#include <stddef.h>
+
+//ring buffer of the ESP cores. one byte of the size is never used, room() is at most size - 1
+class cbuf {
+  private:
+    size_t _size;
+    char *_buf;
+    const char *_bufend;
+    char *_begin;
+    char *_end;
+    char *_wrap(char *ptr) const { return (ptr == _bufend) ? _buf : ptr; }
+  public:
+    cbuf(size_t size);
+    ~cbuf();
+    cbuf(const cbuf &) = delete;
+    cbuf &operator=(const cbuf &) = delete;
+
+    size_t resizeAdd(size_t addSize){ return resize(_size + addSize); }
+    size_t resize(size_t newSize);
+    size_t available() const;
+    size_t size(){ return _size; }
+    size_t room() const;
+    bool empty() const { return _begin == _end; }
+    bool full() const { return room() == 0; }
+    int peek();
+    size_t peek(char *dst, size_t size);
+    int read();
+    size_t read(char *dst, size_t size);
+    size_t write(char c);
+    size_t write(const char *src, size_t size);
+    void flush(){ _begin = _buf; _end = _buf; }
+    size_t remove(size_t size);
+};
+
+#endif /* HOST_CBUF_H_ */
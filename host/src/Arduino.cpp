@@ -0,0 +1,103 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Arduino.h"
+#include <chrono>
+#include <random>
+#include <thread>
+
+//the clock starts with its first use, static constructors of other files may already ask
+static std::chrono::steady_clock::time_point hostStart(){
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return start;
+}
+
+unsigned long millis(){
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - hostStart()).count();
+}
+
+unsigned long micros(){
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart()).count();
+}
+
+void delay(uint32_t ms){
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us){
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield(){
+  std::this_thread::yield();
+}
+
+long random(long howbig){
+  if(howbig <= 0)
+    return 0;
+  static thread_local std::mt19937 gen(std::random_device{}());
+  return std::uniform_int_distribution<long>(0, howbig - 1)(gen);
+}
+
+long random(long howsmall, long howbig){
+  if(howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+static char *toText(unsigned long value, bool negative, char *result, int base){
+  if(base < 2 || base > 36){
+    *result = 0;
+    return result;
+  }
+  char digits[sizeof(unsigned long) * 8 + 1];
+  size_t n = 0;
+  do {
+    unsigned long d = value % base;
+    digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= base;
+  } while(value);
+  char *out = result;
+  if(negative)
+    *out++ = '-';
+  while(n)
+    *out++ = digits[--n];
+  *out = 0;
+  return result;
+}
+
+char *itoa(int value, char *result, int base){
+  return ltoa(value, result, base);
+}
+
+char *ltoa(long value, char *result, int base){
+  //only base 10 numbers get a sign, like on the core
+  if(value < 0 && base == 10)
+    return toText(-(unsigned long)value, true, result, base);
+  return toText((unsigned long)value, false, result, base);
+}
+
+char *utoa(unsigned int value, char *result, int base){
+  return toText(value, false, result, base);
+}
+
+char *ultoa(unsigned long value, char *result, int base){
+  return toText(value, false, result, base);
+}
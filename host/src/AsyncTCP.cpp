@@ -0,0 +1,771 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncTCP.h"
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+//lwIP error codes the callbacks get on the device
+#define ERR_OK 0
+#define ERR_CONN -11
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+
+//tags of the epoll data, the rest is the id of the owner. 0 is the wake up event
+#define LOOP_SERVER (1ULL << 63)
+#define LOOP_ORPHAN (1ULL << 62)
+
+//how long a closed connection may take to deliver what it still had queued
+#define LOOP_LINGER_TIME 5000
+
+//a socket its AsyncClient let go of, it still sends the queued bytes and then waits for the peer to close
+struct AsyncTcpOrphan {
+  int fd;
+  std::string tx;
+  size_t sent;
+  uint32_t since;
+  bool draining;
+};
+
+//one epoll thread for all servers and clients. Events carry ids rather than pointers and every
+//lookup goes through the registry, so a client deleted in a callback never gets another event
+class AsyncTcpLoop {
+  private:
+    std::mutex _lock;
+    int _epoll;
+    int _wake;
+    bool _running;
+    std::atomic<std::thread::id> _thread;
+    uint64_t _nextId;
+    std::unordered_map<uint64_t, AsyncClient *> _clients;
+    std::unordered_map<uint64_t, AsyncServer *> _servers;
+    std::vector<std::pair<uint64_t, bool>> _requests;
+    //only touched on the loop thread
+    std::unordered_map<uint64_t, AsyncTcpOrphan> _orphans;
+    uint8_t _rx[ASYNC_TCP_RX_BUF];
+
+    AsyncTcpLoop()
+      : _epoll(epoll_create1(EPOLL_CLOEXEC))
+      , _wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+      , _running(false)
+      , _thread(std::thread::id())
+      , _nextId(0)
+    {
+      epoll_event ev = {};
+      ev.events = EPOLLIN;
+      ev.data.u64 = 0;
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake, &ev);
+    }
+
+    AsyncClient *_client(uint64_t id){
+      std::lock_guard<std::mutex> guard(_lock);
+      auto it = _clients.find(id);
+      return it == _clients.end() ? NULL : it->second;
+    }
+
+    AsyncServer *_server(uint64_t id){
+      std::lock_guard<std::mutex> guard(_lock);
+      auto it = _servers.find(id);
+      return it == _servers.end() ? NULL : it->second;
+    }
+
+    void _dropOrphan(uint64_t id){
+      auto it = _orphans.find(id);
+      if(it == _orphans.end())
+        return;
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, it->second.fd, NULL);
+      ::close(it->second.fd);
+      _orphans.erase(it);
+    }
+
+    void _orphan(uint64_t id, uint32_t events){
+      auto it = _orphans.find(id);
+      if(it == _orphans.end())
+        return;
+      AsyncTcpOrphan &o = it->second;
+      if(!o.draining){
+        if(events & (EPOLLERR | EPOLLHUP)){
+          _dropOrphan(id);
+          return;
+        }
+        ssize_t n = ::send(o.fd, o.tx.data() + o.sent, o.tx.size() - o.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+          _dropOrphan(id);
+          return;
+        }
+        if(n > 0)
+          o.sent += n;
+        if(o.sent < o.tx.size())
+          return;
+        _drain(id, o);
+        return;
+      }
+      //the peer has the data, wait for its close so unread requests do not turn our close into a reset
+      ssize_t n = ::recv(o.fd, _rx, sizeof(_rx), MSG_DONTWAIT);
+      if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        _dropOrphan(id);
+    }
+
+    void _drain(uint64_t id, AsyncTcpOrphan &o){
+      o.tx.clear();
+      o.sent = 0;
+      o.draining = true;
+      shutdown(o.fd, SHUT_WR);
+      epoll_event ev = {};
+      ev.events = EPOLLIN | EPOLLRDHUP;
+      ev.data.u64 = id;
+      epoll_ctl(_epoll, EPOLL_CTL_MOD, o.fd, &ev);
+    }
+
+    void _carryOut(){
+      std::vector<std::pair<uint64_t, bool>> requests;
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        requests.swap(_requests);
+      }
+      for(const auto &r : requests){
+        AsyncClient *c = _client(r.first);
+        if(c == NULL)
+          continue;
+        if(r.second)
+          c->_abort();
+        else
+          c->_close(false);
+      }
+    }
+
+    void _sweep(uint32_t now){
+      std::vector<uint64_t> ids;
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        ids.reserve(_clients.size());
+        for(const auto &c : _clients)
+          ids.push_back(c.first);
+      }
+      for(uint64_t id : ids){
+        AsyncClient *c = _client(id);
+        if(c != NULL)
+          c->_poll(now);
+      }
+      std::vector<uint64_t> expired;
+      for(const auto &o : _orphans){
+        if(now - o.second.since >= LOOP_LINGER_TIME)
+          expired.push_back(o.first);
+      }
+      for(uint64_t id : expired)
+        _dropOrphan(id);
+    }
+
+    void _run(){
+      epoll_event events[64];
+      uint32_t lastPoll = millis();
+      for(;;){
+        uint32_t elapsed = millis() - lastPoll;
+        int timeout = elapsed >= ASYNC_TCP_POLL_INTERVAL ? 0 : ASYNC_TCP_POLL_INTERVAL - elapsed;
+        int n = epoll_wait(_epoll, events, 64, timeout);
+        for(int i = 0; i < n; i++){
+          uint64_t id = events[i].data.u64;
+          uint32_t ev = events[i].events;
+          if(id == 0){
+            uint64_t value;
+            if(read(_wake, &value, sizeof(value)) < 0){}
+            continue;
+          }
+          if(id & LOOP_SERVER){
+            AsyncServer *s = _server(id);
+            if(s != NULL)
+              s->_accept();
+            continue;
+          }
+          if(id & LOOP_ORPHAN){
+            _orphan(id, ev);
+            continue;
+          }
+          AsyncClient *c = _client(id);
+          if(c != NULL && (ev & EPOLLOUT)){
+            c->_flush();
+            c = _client(id);
+          }
+          if(c != NULL && (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+            c->_read(_rx, sizeof(_rx));
+        }
+        _carryOut();
+        uint32_t now = millis();
+        if(now - lastPoll >= ASYNC_TCP_POLL_INTERVAL){
+          lastPoll = now;
+          _sweep(now);
+        }
+      }
+    }
+
+  public:
+    static AsyncTcpLoop &instance(){
+      //never destroyed, the thread may still run while static destructors do
+      static AsyncTcpLoop *loop = new AsyncTcpLoop();
+      return *loop;
+    }
+
+    void start(){
+      std::lock_guard<std::mutex> guard(_lock);
+      if(_running)
+        return;
+      _running = true;
+      std::thread t([this](){ _run(); });
+      _thread = t.get_id();
+      t.detach();
+    }
+
+    //callers on other threads have to hand closing over to the loop
+    bool onLoopThread(){
+      std::lock_guard<std::mutex> guard(_lock);
+      return !_running || std::this_thread::get_id() == _thread.load();
+    }
+
+    uint64_t add(AsyncClient *c, int fd){
+      std::lock_guard<std::mutex> guard(_lock);
+      uint64_t id = ++_nextId;
+      _clients[id] = c;
+      epoll_event ev = {};
+      ev.events = EPOLLIN | EPOLLRDHUP;
+      ev.data.u64 = id;
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+      return id;
+    }
+
+    uint64_t add(AsyncServer *s, int fd){
+      std::lock_guard<std::mutex> guard(_lock);
+      uint64_t id = ++_nextId | LOOP_SERVER;
+      _servers[id] = s;
+      epoll_event ev = {};
+      ev.events = EPOLLIN;
+      ev.data.u64 = id;
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+      return id;
+    }
+
+    void remove(uint64_t id, int fd){
+      std::lock_guard<std::mutex> guard(_lock);
+      if(id & LOOP_SERVER)
+        _servers.erase(id);
+      else
+        _clients.erase(id);
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, NULL);
+    }
+
+    void watchWrite(uint64_t id, int fd, bool writable){
+      epoll_event ev = {};
+      ev.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0);
+      ev.data.u64 = id;
+      epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    void request(uint64_t id, bool abort){
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        _requests.push_back(std::make_pair(id, abort));
+      }
+      uint64_t one = 1;
+      if(write(_wake, &one, sizeof(one)) < 0){}
+    }
+
+    //takes over the socket of a closed client, called on the loop thread
+    void linger(int fd, const std::string &rest){
+      if(!_running){
+        ::close(fd);
+        return;
+      }
+      uint64_t id;
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        id = ++_nextId | LOOP_ORPHAN;
+      }
+      AsyncTcpOrphan &o = _orphans[id];
+      o.fd = fd;
+      o.tx = rest;
+      o.sent = 0;
+      o.since = millis();
+      o.draining = false;
+      epoll_event ev = {};
+      ev.events = EPOLLOUT;
+      ev.data.u64 = id;
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+      if(rest.empty())
+        _drain(id, o);
+    }
+};
+
+/*
+ * AsyncClient
+ */
+
+AsyncClient::AsyncClient(int sockfd)
+  : _fd(sockfd)
+  , _id(0)
+  , _closing(false)
+  , _txSent(0)
+  , _txArmed(false)
+  , _busy(false)
+  , _sentAt(0)
+  , _rxLastPacket(millis())
+  , _rxTimeout(0)
+  , _ackTimeout(ASYNC_MAX_ACK_TIME)
+  , _discardCb(NULL)
+  , _discardCbArg(NULL)
+  , _sentCb(NULL)
+  , _sentCbArg(NULL)
+  , _errorCb(NULL)
+  , _errorCbArg(NULL)
+  , _recvCb(NULL)
+  , _recvCbArg(NULL)
+  , _timeoutCb(NULL)
+  , _timeoutCbArg(NULL)
+  , _pollCb(NULL)
+  , _pollCbArg(NULL)
+{
+  if(_fd < 0)
+    return;
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+  _id = AsyncTcpLoop::instance().add(this, _fd);
+}
+
+AsyncClient::~AsyncClient(){
+  int fd = _detach();
+  if(fd >= 0)
+    ::close(fd);
+}
+
+int AsyncClient::_detach(){
+  std::lock_guard<std::mutex> guard(_txLock);
+  int fd = _fd;
+  if(fd < 0)
+    return -1;
+  AsyncTcpLoop::instance().remove(_id, fd);
+  _fd = -1;
+  _txArmed = false;
+  _busy = false;
+  return fd;
+}
+
+void AsyncClient::close(bool now){
+  if(_fd < 0)
+    return;
+  if(!AsyncTcpLoop::instance().onLoopThread()){
+    _closing = true;
+    AsyncTcpLoop::instance().request(_id, false);
+    return;
+  }
+  _close(now);
+}
+
+//like lwIP the queued bytes still go out after a close, now or not
+void AsyncClient::_close(bool now __attribute__((unused))){
+  std::string rest;
+  {
+    std::lock_guard<std::mutex> guard(_txLock);
+    if(_fd < 0)
+      return;
+    rest = _tx.substr(_txSent);
+    _tx.clear();
+    _txSent = 0;
+  }
+  int fd = _detach();
+  if(fd < 0)
+    return;
+  AsyncTcpLoop::instance().linger(fd, rest);
+  if(_discardCb)
+    _discardCb(_discardCbArg, this);
+}
+
+int8_t AsyncClient::abort(){
+  if(_fd < 0)
+    return ERR_ABRT;
+  if(!AsyncTcpLoop::instance().onLoopThread()){
+    _closing = true;
+    AsyncTcpLoop::instance().request(_id, true);
+    return ERR_ABRT;
+  }
+  _abort();
+  return ERR_ABRT;
+}
+
+void AsyncClient::_abort(){
+  int fd = _detach();
+  if(fd < 0)
+    return;
+  //close with a reset like tcp_abort does
+  struct linger l = { 1, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+  ::close(fd);
+  _error(ERR_ABRT);
+}
+
+void AsyncClient::_error(int8_t err){
+  if(_errorCb)
+    _errorCb(_errorCbArg, this, err);
+  if(_discardCb)
+    _discardCb(_discardCbArg, this);
+}
+
+void AsyncClient::free(){
+  int fd = _detach();
+  if(fd >= 0)
+    ::close(fd);
+}
+
+size_t AsyncClient::space(){
+  std::lock_guard<std::mutex> guard(_txLock);
+  if(_fd < 0 || _closing)
+    return 0;
+  size_t queued = _tx.size() - _txSent;
+  return queued >= ASYNC_TCP_SND_BUF ? 0 : ASYNC_TCP_SND_BUF - queued;
+}
+
+size_t AsyncClient::add(const char *data, size_t size, uint8_t apiflags __attribute__((unused))){
+  if(data == NULL || size == 0)
+    return 0;
+  std::lock_guard<std::mutex> guard(_txLock);
+  if(_fd < 0 || _closing)
+    return 0;
+  size_t queued = _tx.size() - _txSent;
+  if(queued >= ASYNC_TCP_SND_BUF)
+    return 0;
+  size_t will_send = std::min(size, (size_t)(ASYNC_TCP_SND_BUF - queued));
+  if(_txSent && _txSent >= _tx.size() / 2){
+    _tx.erase(0, _txSent);
+    _txSent = 0;
+  }
+  _tx.append(data, will_send);
+  return will_send;
+}
+
+bool AsyncClient::send(){
+  std::lock_guard<std::mutex> guard(_txLock);
+  if(_fd < 0 || _closing)
+    return false;
+  if(_txSent == _tx.size())
+    return true;
+  if(!_busy){
+    _busy = true;
+    _sentAt = millis();
+  }
+  //the loop writes and reports the ack, never from inside send() like on the device
+  if(!_txArmed){
+    AsyncTcpLoop::instance().watchWrite(_id, _fd, true);
+    _txArmed = true;
+  }
+  return true;
+}
+
+size_t AsyncClient::write(const char *data){
+  if(data == NULL)
+    return 0;
+  return write(data, strlen(data));
+}
+
+size_t AsyncClient::write(const char *data, size_t size, uint8_t apiflags){
+  size_t will_send = add(data, size, apiflags);
+  if(!will_send || !send())
+    return 0;
+  return will_send;
+}
+
+void AsyncClient::_flush(){
+  size_t written = 0;
+  uint32_t rtt = 0;
+  bool failed = false;
+  {
+    std::lock_guard<std::mutex> guard(_txLock);
+    if(_fd < 0)
+      return;
+    size_t pending = _tx.size() - _txSent;
+    if(pending){
+      ssize_t n = ::send(_fd, _tx.data() + _txSent, pending, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if(n > 0){
+        written = n;
+        _txSent += n;
+        rtt = millis() - _sentAt;
+      } else if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        failed = true;
+    }
+    if(_txSent == _tx.size()){
+      _tx.clear();
+      _txSent = 0;
+      _busy = false;
+      if(_txArmed){
+        AsyncTcpLoop::instance().watchWrite(_id, _fd, false);
+        _txArmed = false;
+      }
+    } else if(written)
+      _sentAt = millis();
+  }
+  if(failed){
+    int fd = _detach();
+    if(fd >= 0)
+      ::close(fd);
+    _error(ERR_RST);
+    return;
+  }
+  if(written && _sentCb)
+    _sentCb(_sentCbArg, this, written, rtt);
+}
+
+void AsyncClient::_read(uint8_t *buf, size_t size){
+  if(_fd < 0)
+    return;
+  ssize_t n = ::recv(_fd, buf, size, MSG_DONTWAIT);
+  if(n > 0){
+    _rxLastPacket = millis();
+    if(_recvCb)
+      _recvCb(_recvCbArg, this, buf, n);
+    return;
+  }
+  if(n == 0){
+    //the peer closed, lwIP hands the client the same close
+    _close(false);
+    return;
+  }
+  if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    return;
+  int fd = _detach();
+  if(fd >= 0)
+    ::close(fd);
+  _error(errno == ECONNRESET ? ERR_RST : ERR_CONN);
+}
+
+void AsyncClient::_poll(uint32_t now){
+  if(_fd < 0 || _closing)
+    return;
+  bool ackTimeout = false;
+  uint32_t sentAt;
+  {
+    std::lock_guard<std::mutex> guard(_txLock);
+    sentAt = _sentAt;
+    if(_busy && _ackTimeout && (now - sentAt) >= _ackTimeout){
+      _busy = false;
+      ackTimeout = true;
+    }
+  }
+  //the same order as AsyncTCP: ack timeout, rx timeout, then the poll callback
+  if(ackTimeout){
+    if(_timeoutCb)
+      _timeoutCb(_timeoutCbArg, this, now - sentAt);
+    return;
+  }
+  if(_rxTimeout && (now - _rxLastPacket) >= (_rxTimeout * 1000)){
+    _close(false);
+    return;
+  }
+  if(_pollCb)
+    _pollCb(_pollCbArg, this);
+}
+
+uint8_t AsyncClient::state(){
+  if(_fd < 0)
+    return 0;
+  return _closing ? 5 : 4;
+}
+
+bool AsyncClient::connected(){
+  return state() == 4;
+}
+
+bool AsyncClient::disconnecting(){
+  return state() > 4;
+}
+
+bool AsyncClient::disconnected(){
+  uint8_t s = state();
+  return s == 0 || s > 4;
+}
+
+void AsyncClient::setNoDelay(bool nodelay){
+  if(_fd < 0)
+    return;
+  int flag = nodelay ? 1 : 0;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+bool AsyncClient::getNoDelay(){
+  if(_fd < 0)
+    return false;
+  int flag = 0;
+  socklen_t len = sizeof(flag);
+  getsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, &len);
+  return flag != 0;
+}
+
+IPAddress AsyncClient::_address(bool local) const {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if(_fd < 0 || (local ? getsockname(_fd, (struct sockaddr *)&addr, &len) : getpeername(_fd, (struct sockaddr *)&addr, &len)) != 0)
+    return IPAddress();
+  if(addr.ss_family == AF_INET)
+    return IPAddress((uint32_t)((struct sockaddr_in *)&addr)->sin_addr.s_addr);
+  if(addr.ss_family == AF_INET6)
+    return IPAddress(((struct sockaddr_in6 *)&addr)->sin6_addr.s6_addr + 12);
+  return IPAddress();
+}
+
+uint16_t AsyncClient::_port(bool local) const {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if(_fd < 0 || (local ? getsockname(_fd, (struct sockaddr *)&addr, &len) : getpeername(_fd, (struct sockaddr *)&addr, &len)) != 0)
+    return 0;
+  if(addr.ss_family == AF_INET)
+    return ntohs(((struct sockaddr_in *)&addr)->sin_port);
+  if(addr.ss_family == AF_INET6)
+    return ntohs(((struct sockaddr_in6 *)&addr)->sin6_port);
+  return 0;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void *arg){
+  _discardCb = cb;
+  _discardCbArg = arg;
+}
+
+void AsyncClient::onAck(AcAckHandler cb, void *arg){
+  _sentCb = cb;
+  _sentCbArg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void *arg){
+  _errorCb = cb;
+  _errorCbArg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void *arg){
+  _recvCb = cb;
+  _recvCbArg = arg;
+}
+
+void AsyncClient::onTimeout(AcTimeoutHandler cb, void *arg){
+  _timeoutCb = cb;
+  _timeoutCbArg = arg;
+}
+
+void AsyncClient::onPoll(AcConnectHandler cb, void *arg){
+  _pollCb = cb;
+  _pollCbArg = arg;
+}
+
+const char *AsyncClient::errorToString(int8_t error){
+  switch(error){
+    case ERR_OK: return "OK";
+    case ERR_CONN: return "Not connected";
+    case ERR_ABRT: return "Connection aborted";
+    case ERR_RST: return "Connection reset";
+    case ERR_CLSD: return "Connection closed";
+    default: return "UNKNOWN";
+  }
+}
+
+const char *AsyncClient::stateToString(){
+  switch(state()){
+    case 0: return "Closed";
+    case 4: return "Established";
+    case 5: return "Fin Wait 1";
+    default: return "UNKNOWN";
+  }
+}
+
+/*
+ * AsyncServer
+ */
+
+AsyncServer::AsyncServer(IPAddress addr, uint16_t port)
+  : _port(port)
+  , _addr(addr)
+  , _noDelay(false)
+  , _fd(-1)
+  , _id(0)
+  , _connectCb(NULL)
+  , _connectCbArg(NULL)
+{}
+
+AsyncServer::AsyncServer(uint16_t port)
+  : AsyncServer(IPAddress(), port)
+{}
+
+AsyncServer::~AsyncServer(){
+  end();
+}
+
+void AsyncServer::onClient(AcConnectHandler cb, void *arg){
+  _connectCb = cb;
+  _connectCbArg = arg;
+}
+
+void AsyncServer::begin(){
+  if(_fd >= 0)
+    return;
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(fd < 0)
+    return;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(_port);
+  addr.sin_addr.s_addr = (uint32_t)_addr;
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0){
+    fprintf(stderr, "AsyncServer: can not listen on port %u: %s\n", _port, strerror(errno));
+    ::close(fd);
+    return;
+  }
+  _fd = fd;
+  AsyncTcpLoop::instance().start();
+  _id = AsyncTcpLoop::instance().add(this, _fd);
+}
+
+void AsyncServer::end(){
+  if(_fd < 0)
+    return;
+  AsyncTcpLoop::instance().remove(_id, _fd);
+  ::close(_fd);
+  _fd = -1;
+}
+
+void AsyncServer::_accept(){
+  while(_fd >= 0){
+    int fd = accept4(_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0)
+      return;
+    if(_noDelay){
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    AsyncClient *c = new AsyncClient(fd);
+    if(_connectCb)
+      _connectCb(_connectCbArg, c);
+    else
+      delete c;
+  }
+}
@@ -0,0 +1,257 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "FS.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace fs;
+
+namespace fs {
+
+class FileImpl {
+  public:
+    std::string fullPath;
+    std::string path;
+    FILE *file;
+    DIR *dir;
+    FileImpl(const std::string &full, const std::string &p): fullPath(full), path(p), file(NULL), dir(NULL) {}
+    ~FileImpl(){ close(); }
+    void close(){
+      if(file != NULL)
+        fclose(file);
+      if(dir != NULL)
+        closedir(dir);
+      file = NULL;
+      dir = NULL;
+    }
+    const char *name() const {
+      size_t slash = path.rfind('/');
+      return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+};
+
+}
+
+size_t File::write(uint8_t c){
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size){
+  if(!_p || _p->file == NULL)
+    return 0;
+  return fwrite(buf, 1, size, _p->file);
+}
+
+int File::available(){
+  if(!_p || _p->file == NULL)
+    return 0;
+  size_t s = size();
+  size_t pos = position();
+  return pos < s ? s - pos : 0;
+}
+
+int File::read(){
+  if(!_p || _p->file == NULL)
+    return -1;
+  return fgetc(_p->file);
+}
+
+int File::peek(){
+  if(!_p || _p->file == NULL)
+    return -1;
+  int c = fgetc(_p->file);
+  if(c != EOF)
+    ungetc(c, _p->file);
+  return c;
+}
+
+void File::flush(){
+  if(_p && _p->file != NULL)
+    fflush(_p->file);
+}
+
+size_t File::read(uint8_t *buf, size_t size){
+  if(!_p || _p->file == NULL)
+    return 0;
+  return fread(buf, 1, size, _p->file);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+  if(!_p || _p->file == NULL)
+    return false;
+  int whence = (mode == SeekCur) ? SEEK_CUR : (mode == SeekEnd) ? SEEK_END : SEEK_SET;
+  return fseek(_p->file, pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if(!_p || _p->file == NULL)
+    return 0;
+  long pos = ftell(_p->file);
+  return pos < 0 ? 0 : pos;
+}
+
+size_t File::size() const {
+  if(!_p || _p->file == NULL)
+    return 0;
+  struct stat st;
+  if(fstat(fileno(_p->file), &st) != 0)
+    return 0;
+  return st.st_size;
+}
+
+void File::close(){
+  if(_p){
+    _p->close();
+    _p = NULL;
+  }
+}
+
+File::operator bool() const {
+  return _p && (_p->file != NULL || _p->dir != NULL);
+}
+
+time_t File::getLastWrite(){
+  struct stat st;
+  if(!_p || stat(_p->fullPath.c_str(), &st) != 0)
+    return 0;
+  return st.st_mtime;
+}
+
+const char *File::path() const {
+  return _p ? _p->path.c_str() : NULL;
+}
+
+const char *File::name() const {
+  return _p ? _p->name() : NULL;
+}
+
+bool File::isDirectory(void){
+  return _p && _p->dir != NULL;
+}
+
+File File::openNextFile(const char *mode){
+  if(!_p || _p->dir == NULL)
+    return File();
+  struct dirent *entry;
+  while((entry = readdir(_p->dir)) != NULL){
+    if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+    std::string sep = (_p->path.empty() || _p->path.back() != '/') ? "/" : "";
+    std::string child = _p->path + sep + entry->d_name;
+    std::string full = _p->fullPath + "/" + entry->d_name;
+    FileImplPtr impl = std::make_shared<FileImpl>(full, child);
+    struct stat st;
+    if(stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+      impl->dir = opendir(full.c_str());
+    else
+      impl->file = fopen(full.c_str(), mode);
+    return File(impl);
+  }
+  return File();
+}
+
+void File::rewindDirectory(void){
+  if(_p && _p->dir != NULL)
+    rewinddir(_p->dir);
+}
+
+FS::FS(const char *root): _root(root ? root : ".") {
+  while(_root.length() > 1 && _root.back() == '/')
+    _root.pop_back();
+}
+
+bool FS::_resolve(const char *path, std::string &out) const {
+  if(path == NULL || path[0] != '/')
+    return false;
+  //no component may leave the root
+  const char *p = path;
+  while(*p){
+    while(*p == '/')
+      p++;
+    const char *end = strchr(p, '/');
+    size_t len = end ? (size_t)(end - p) : strlen(p);
+    if(len == 2 && p[0] == '.' && p[1] == '.')
+      return false;
+    p += len;
+  }
+  out = _root + path;
+  return true;
+}
+
+File FS::open(const char *path, const char *mode, const bool create){
+  std::string full;
+  if(!_resolve(path, full) || mode == NULL)
+    return File();
+  FileImplPtr impl = std::make_shared<FileImpl>(full, path);
+  struct stat st;
+  bool exists = stat(full.c_str(), &st) == 0;
+  if(exists && S_ISDIR(st.st_mode)){
+    impl->dir = opendir(full.c_str());
+    return File(impl);
+  }
+  if(!exists && mode[0] == 'r')
+    return File();
+  if(create && mode[0] != 'r'){
+    //parent directories are made like the create flag of the core does
+    for(size_t i = _root.length() + 1; i < full.length(); i++){
+      if(full[i] == '/'){
+        std::string dir = full.substr(0, i);
+        ::mkdir(dir.c_str(), 0755);
+      }
+    }
+  }
+  std::string m = mode;
+  if(m.find('b') == std::string::npos)
+    m += 'b';
+  impl->file = fopen(full.c_str(), m.c_str());
+  if(impl->file == NULL)
+    return File();
+  return File(impl);
+}
+
+bool FS::exists(const char *path){
+  std::string full;
+  struct stat st;
+  return _resolve(path, full) && stat(full.c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path){
+  std::string full;
+  return _resolve(path, full) && unlink(full.c_str()) == 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo){
+  std::string from, to;
+  return _resolve(pathFrom, from) && _resolve(pathTo, to) && ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path){
+  std::string full;
+  return _resolve(path, full) && (::mkdir(full.c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char *path){
+  std::string full;
+  return _resolve(path, full) && ::rmdir(full.c_str()) == 0;
+}
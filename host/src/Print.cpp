@@ -0,0 +1,83 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Print.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size){
+  size_t n = 0;
+  while(size--){
+    if(!write(*buffer++))
+      break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...){
+  char loc[64];
+  va_list arg;
+  va_start(arg, format);
+  int len = vsnprintf(loc, sizeof(loc), format, arg);
+  va_end(arg);
+  if(len < 0)
+    return 0;
+  if((size_t)len < sizeof(loc))
+    return write((const uint8_t *)loc, len);
+  char *temp = (char *)malloc(len + 1);
+  if(temp == NULL)
+    return 0;
+  va_start(arg, format);
+  vsnprintf(temp, len + 1, format, arg);
+  va_end(arg);
+  len = write((const uint8_t *)temp, len);
+  free(temp);
+  return len;
+}
+
+size_t Print::_printNumber(unsigned long long n, uint8_t base, bool negative){
+  if(base < 2)
+    base = 10;
+  char buf[66];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = 0;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  if(negative)
+    *--str = '-';
+  return write(str);
+}
+
+size_t Print::print(long long n, int base){
+  if(base == DEC && n < 0)
+    return _printNumber(-(unsigned long long)n, base, true);
+  return _printNumber((unsigned long long)n, base, false);
+}
+
+size_t Print::print(double n, int digits){
+  char buf[64];
+  int len = snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write((const uint8_t *)buf, len);
+}
@@ -0,0 +1,66 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Stream.h"
+
+int Stream::timedRead(){
+  //host streams are files and buffers, data that is not there now will not come
+  return read();
+}
+
+size_t Stream::readBytes(char *buffer, size_t length){
+  size_t count = 0;
+  while(count < length){
+    int c = timedRead();
+    if(c < 0)
+      break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length){
+  size_t index = 0;
+  while(index < length){
+    int c = timedRead();
+    if(c < 0 || c == terminator)
+      break;
+    *buffer++ = (char)c;
+    index++;
+  }
+  return index;
+}
+
+String Stream::readString(){
+  String ret;
+  int c;
+  while((c = timedRead()) >= 0)
+    ret += (char)c;
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator){
+  String ret;
+  int c;
+  while((c = timedRead()) >= 0 && c != terminator)
+    ret += (char)c;
+  return ret;
+}
@@ -0,0 +1,190 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+std::string String::_number(unsigned long long value, unsigned char base, bool negative){
+  if(base < 2 || base > 36)
+    base = 10;
+  char buf[66];
+  char *p = buf + sizeof(buf) - 1;
+  *p = 0;
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while(value);
+  if(negative)
+    *--p = '-';
+  return std::string(p);
+}
+
+std::string String::_float(double value, unsigned int decimalPlaces){
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  return std::string(buf);
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  if(length() != s.length())
+    return false;
+  for(size_t i = 0; i < _s.length(); i++){
+    if(tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i]))
+      return false;
+  }
+  return true;
+}
+
+bool String::equalsConstantTime(const String &s) const {
+  if(length() != s.length())
+    return false;
+  unsigned char diff = 0;
+  for(size_t i = 0; i < _s.length(); i++)
+    diff |= _s[i] ^ s._s[i];
+  return diff == 0;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  if(offset > _s.length() || prefix.length() > _s.length() - offset)
+    return false;
+  return _s.compare(offset, prefix.length(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  if(suffix.length() > _s.length())
+    return false;
+  return _s.compare(_s.length() - suffix.length(), suffix.length(), suffix._s) == 0;
+}
+
+char &String::operator[](unsigned int index){
+  static char dummy;
+  if(index >= _s.length()){
+    dummy = 0;
+    return dummy;
+  }
+  return _s[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+  if(!bufsize || !buf)
+    return;
+  if(index >= _s.length()){
+    buf[0] = 0;
+    return;
+  }
+  size_t n = std::min((size_t)bufsize - 1, _s.length() - index);
+  memcpy(buf, _s.c_str() + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  size_t p = _s.find(ch, fromIndex);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const char *str, unsigned int fromIndex) const {
+  if(str == NULL || fromIndex > _s.length())
+    return -1;
+  size_t p = _s.find(str, fromIndex);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+  if(_s.empty() || fromIndex >= _s.length())
+    return -1;
+  size_t p = _s.rfind(ch, fromIndex);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+  if(str.length() > _s.length() || fromIndex >= _s.length())
+    return -1;
+  size_t p = _s.rfind(str._s, fromIndex);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if(beginIndex > endIndex)
+    std::swap(beginIndex, endIndex);
+  if(beginIndex >= _s.length())
+    return String();
+  if(endIndex > _s.length())
+    endIndex = _s.length();
+  return String(_s.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace){
+  for(auto &c: _s){
+    if(c == find)
+      c = replace;
+  }
+}
+
+void String::replace(const String &find, const String &replace){
+  if(find._s.empty())
+    return;
+  size_t p = 0;
+  while((p = _s.find(find._s, p)) != std::string::npos){
+    _s.replace(p, find._s.length(), replace._s);
+    p += replace._s.length();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count){
+  if(index >= _s.length())
+    return;
+  _s.erase(index, count);
+}
+
+void String::toLowerCase(){
+  for(auto &c: _s)
+    c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase(){
+  for(auto &c: _s)
+    c = toupper((unsigned char)c);
+}
+
+void String::trim(){
+  size_t first = _s.find_first_not_of(" \t\r\n\f\v");
+  if(first == std::string::npos){
+    _s.clear();
+    return;
+  }
+  size_t last = _s.find_last_not_of(" \t\r\n\f\v");
+  _s = _s.substr(first, last - first + 1);
+}
+
+long String::toInt() const {
+  return atol(_s.c_str());
+}
+
+float String::toFloat() const {
+  return atof(_s.c_str());
+}
+
+double String::toDouble() const {
+  return atof(_s.c_str());
+}
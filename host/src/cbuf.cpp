@@ -0,0 +1,132 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "cbuf.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+cbuf::cbuf(size_t size)
+  : _size(size)
+  , _buf((char *)malloc(size))
+  , _bufend(_buf + size)
+  , _begin(_buf)
+  , _end(_begin)
+{}
+
+cbuf::~cbuf(){
+  free(_buf);
+}
+
+size_t cbuf::resize(size_t newSize){
+  size_t bytesAvailable = available();
+  //a buffer never shrinks below what it holds
+  if((newSize <= bytesAvailable) || (newSize == _size))
+    return _size;
+  char *newbuf = (char *)malloc(newSize);
+  if(newbuf == NULL)
+    return _size;
+  if(_buf != NULL)
+    read(newbuf, bytesAvailable);
+  free(_buf);
+  _begin = newbuf;
+  _end = newbuf + bytesAvailable;
+  _bufend = newbuf + newSize;
+  _size = newSize;
+  _buf = newbuf;
+  return _size;
+}
+
+size_t cbuf::available() const {
+  if(_end >= _begin)
+    return _end - _begin;
+  return _size - (_begin - _end);
+}
+
+size_t cbuf::room() const {
+  if(!_size)
+    return 0;
+  if(_end >= _begin)
+    return _size - (_end - _begin) - 1;
+  return _begin - _end - 1;
+}
+
+int cbuf::peek(){
+  if(empty())
+    return -1;
+  return (unsigned char)*_begin;
+}
+
+size_t cbuf::peek(char *dst, size_t size){
+  size_t bytes = std::min(size, available());
+  size_t toEnd = _bufend - _begin;
+  if(bytes <= toEnd){
+    memcpy(dst, _begin, bytes);
+  } else {
+    memcpy(dst, _begin, toEnd);
+    memcpy(dst + toEnd, _buf, bytes - toEnd);
+  }
+  return bytes;
+}
+
+int cbuf::read(){
+  if(empty())
+    return -1;
+  char result = *_begin;
+  _begin = _wrap(_begin + 1);
+  return (unsigned char)result;
+}
+
+size_t cbuf::read(char *dst, size_t size){
+  size_t bytes = peek(dst, size);
+  remove(bytes);
+  return bytes;
+}
+
+size_t cbuf::write(char c){
+  if(full())
+    return 0;
+  *_end = c;
+  _end = _wrap(_end + 1);
+  return 1;
+}
+
+size_t cbuf::write(const char *src, size_t size){
+  size_t bytes = std::min(size, room());
+  if(!bytes)
+    return 0;
+  size_t toEnd = _bufend - _end;
+  if(bytes <= toEnd){
+    memcpy(_end, src, bytes);
+  } else {
+    memcpy(_end, src, toEnd);
+    memcpy(_buf, src + toEnd, bytes - toEnd);
+  }
+  _end = _buf + ((_end - _buf) + bytes) % _size;
+  return bytes;
+}
+
+size_t cbuf::remove(size_t size){
+  size_t bytes = std::min(size, available());
+  if(!bytes)
+    return 0;
+  _begin = _buf + ((_begin - _buf) + bytes) % _size;
+  return bytes;
+}
@@ -0,0 +1,191 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "mbedtls/md5.h"
+#include <string.h>
+
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define MD5_STEP(f, a, b, c, d, x, t, s) \
+  (a) += f((b), (c), (d)) + (x) + (t); \
+  (a) = MD5_ROTL((a), (s)) + (b);
+
+static uint32_t md5_get(const unsigned char *p){
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void md5_put(uint32_t v, unsigned char *p){
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static void md5_process(mbedtls_md5_context *ctx, const unsigned char data[64]){
+  uint32_t x[16];
+  uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+  int i;
+  for(i = 0; i < 16; i++)
+    x[i] = md5_get(data + i * 4);
+
+  MD5_STEP(MD5_F, a, b, c, d, x[0], 0xd76aa478, 7)
+  MD5_STEP(MD5_F, d, a, b, c, x[1], 0xe8c7b756, 12)
+  MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070db, 17)
+  MD5_STEP(MD5_F, b, c, d, a, x[3], 0xc1bdceee, 22)
+  MD5_STEP(MD5_F, a, b, c, d, x[4], 0xf57c0faf, 7)
+  MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787c62a, 12)
+  MD5_STEP(MD5_F, c, d, a, b, x[6], 0xa8304613, 17)
+  MD5_STEP(MD5_F, b, c, d, a, x[7], 0xfd469501, 22)
+  MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098d8, 7)
+  MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8b44f7af, 12)
+  MD5_STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+  MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895cd7be, 22)
+  MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6b901122, 7)
+  MD5_STEP(MD5_F, d, a, b, c, x[13], 0xfd987193, 12)
+  MD5_STEP(MD5_F, c, d, a, b, x[14], 0xa679438e, 17)
+  MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49b40821, 22)
+
+  MD5_STEP(MD5_G, a, b, c, d, x[1], 0xf61e2562, 5)
+  MD5_STEP(MD5_G, d, a, b, c, x[6], 0xc040b340, 9)
+  MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51, 14)
+  MD5_STEP(MD5_G, b, c, d, a, x[0], 0xe9b6c7aa, 20)
+  MD5_STEP(MD5_G, a, b, c, d, x[5], 0xd62f105d, 5)
+  MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453, 9)
+  MD5_STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+  MD5_STEP(MD5_G, b, c, d, a, x[4], 0xe7d3fbc8, 20)
+  MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21e1cde6, 5)
+  MD5_STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6, 9)
+  MD5_STEP(MD5_G, c, d, a, b, x[3], 0xf4d50d87, 14)
+  MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455a14ed, 20)
+  MD5_STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905, 5)
+  MD5_STEP(MD5_G, d, a, b, c, x[2], 0xfcefa3f8, 9)
+  MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676f02d9, 14)
+  MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+
+  MD5_STEP(MD5_H, a, b, c, d, x[5], 0xfffa3942, 4)
+  MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771f681, 11)
+  MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+  MD5_STEP(MD5_H, b, c, d, a, x[14], 0xfde5380c, 23)
+  MD5_STEP(MD5_H, a, b, c, d, x[1], 0xa4beea44, 4)
+  MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4bdecfa9, 11)
+  MD5_STEP(MD5_H, c, d, a, b, x[7], 0xf6bb4b60, 16)
+  MD5_STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+  MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6, 4)
+  MD5_STEP(MD5_H, d, a, b, c, x[0], 0xeaa127fa, 11)
+  MD5_STEP(MD5_H, c, d, a, b, x[3], 0xd4ef3085, 16)
+  MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881d05, 23)
+  MD5_STEP(MD5_H, a, b, c, d, x[9], 0xd9d4d039, 4)
+  MD5_STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+  MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+  MD5_STEP(MD5_H, b, c, d, a, x[2], 0xc4ac5665, 23)
+
+  MD5_STEP(MD5_I, a, b, c, d, x[0], 0xf4292244, 6)
+  MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432aff97, 10)
+  MD5_STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7, 15)
+  MD5_STEP(MD5_I, b, c, d, a, x[5], 0xfc93a039, 21)
+  MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3, 6)
+  MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8f0ccc92, 10)
+  MD5_STEP(MD5_I, c, d, a, b, x[10], 0xffeff47d, 15)
+  MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845dd1, 21)
+  MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6fa87e4f, 6)
+  MD5_STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+  MD5_STEP(MD5_I, c, d, a, b, x[6], 0xa3014314, 15)
+  MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+  MD5_STEP(MD5_I, a, b, c, d, x[4], 0xf7537e82, 6)
+  MD5_STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235, 10)
+  MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2ad7d2bb, 15)
+  MD5_STEP(MD5_I, b, c, d, a, x[9], 0xeb86d391, 21)
+
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context *ctx){
+  memset(ctx, 0, sizeof(mbedtls_md5_context));
+}
+
+void mbedtls_md5_free(mbedtls_md5_context *ctx){
+  if(ctx != NULL)
+    memset(ctx, 0, sizeof(mbedtls_md5_context));
+}
+
+int mbedtls_md5_starts(mbedtls_md5_context *ctx){
+  ctx->total[0] = 0;
+  ctx->total[1] = 0;
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+  return 0;
+}
+
+int mbedtls_md5_update(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen){
+  size_t fill;
+  uint32_t left;
+  if(ilen == 0)
+    return 0;
+  left = ctx->total[0] & 0x3f;
+  fill = 64 - left;
+  ctx->total[0] += (uint32_t)ilen;
+  if(ctx->total[0] < (uint32_t)ilen)
+    ctx->total[1]++;
+  if(left && ilen >= fill){
+    memcpy(ctx->buffer + left, input, fill);
+    md5_process(ctx, ctx->buffer);
+    input += fill;
+    ilen -= fill;
+    left = 0;
+  }
+  while(ilen >= 64){
+    md5_process(ctx, input);
+    input += 64;
+    ilen -= 64;
+  }
+  if(ilen > 0)
+    memcpy(ctx->buffer + left, input, ilen);
+  return 0;
+}
+
+int mbedtls_md5_finish(mbedtls_md5_context *ctx, unsigned char output[16]){
+  uint32_t used = ctx->total[0] & 0x3f;
+  uint32_t high = (ctx->total[0] >> 29) | (ctx->total[1] << 3);
+  uint32_t low = ctx->total[0] << 3;
+  ctx->buffer[used++] = 0x80;
+  if(used <= 56){
+    memset(ctx->buffer + used, 0, 56 - used);
+  } else {
+    memset(ctx->buffer + used, 0, 64 - used);
+    md5_process(ctx, ctx->buffer);
+    memset(ctx->buffer, 0, 56);
+  }
+  md5_put(low, ctx->buffer + 56);
+  md5_put(high, ctx->buffer + 60);
+  md5_process(ctx, ctx->buffer);
+  md5_put(ctx->state[0], output);
+  md5_put(ctx->state[1], output + 4);
+  md5_put(ctx->state[2], output + 8);
+  md5_put(ctx->state[3], output + 12);
+  return 0;
+}
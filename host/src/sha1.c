@@ -0,0 +1,114 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include <stdint.h>
+#include <string.h>
+
+//SHA-1 under the names AsyncWebSocket.cpp declares for the handshake key, like the ESP32 core has them
+
+typedef struct {
+  uint32_t state[5];
+  uint32_t count[2];
+  unsigned char buffer[64];
+} SHA1_CTX;
+
+#define SHA1_ROTL(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+void SHA1Transform(uint32_t state[5], const unsigned char buffer[64]){
+  uint32_t w[80];
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  int i;
+  for(i = 0; i < 16; i++)
+    w[i] = ((uint32_t)buffer[i * 4] << 24) | ((uint32_t)buffer[i * 4 + 1] << 16) | ((uint32_t)buffer[i * 4 + 2] << 8) | buffer[i * 4 + 3];
+  for(i = 16; i < 80; i++)
+    w[i] = SHA1_ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  for(i = 0; i < 80; i++){
+    uint32_t f, k;
+    if(i < 20){
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    } else if(i < 40){
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    } else if(i < 60){
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+    uint32_t t = SHA1_ROTL(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = SHA1_ROTL(b, 30);
+    b = a;
+    a = t;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void SHA1Init(SHA1_CTX *context){
+  context->state[0] = 0x67452301;
+  context->state[1] = 0xefcdab89;
+  context->state[2] = 0x98badcfe;
+  context->state[3] = 0x10325476;
+  context->state[4] = 0xc3d2e1f0;
+  context->count[0] = 0;
+  context->count[1] = 0;
+}
+
+void SHA1Update(SHA1_CTX *context, const unsigned char *data, uint32_t len){
+  uint32_t i = 0;
+  uint32_t j = (context->count[0] >> 3) & 63;
+  if((context->count[0] += len << 3) < (len << 3))
+    context->count[1]++;
+  context->count[1] += (len >> 29);
+  if((j + len) > 63){
+    i = 64 - j;
+    memcpy(&context->buffer[j], data, i);
+    SHA1Transform(context->state, context->buffer);
+    for(; i + 63 < len; i += 64)
+      SHA1Transform(context->state, &data[i]);
+    j = 0;
+  }
+  memcpy(&context->buffer[j], &data[i], len - i);
+}
+
+void SHA1Final(unsigned char digest[20], SHA1_CTX *context){
+  unsigned char finalcount[8];
+  unsigned char c;
+  int i;
+  for(i = 0; i < 8; i++)
+    finalcount[i] = (unsigned char)((context->count[(i >= 4 ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255);
+  c = 0200;
+  SHA1Update(context, &c, 1);
+  while((context->count[0] & 504) != 448){
+    c = 0000;
+    SHA1Update(context, &c, 1);
+  }
+  SHA1Update(context, finalcount, 8);
+  for(i = 0; i < 20; i++)
+    digest[i] = (unsigned char)((context->state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
+  memset(context, 0, sizeof(*context));
+}
@@ -19,106 +19,201 @@
 */
 #include "Arduino.h"
 #include "AsyncEventSource.h"
+#include <new>
 
-static String generateEventMessage(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
-  String ev = "";
-
-  if (reconnect) {
-    ev += "retry: ";
-    ev += String(reconnect);
-    ev += "\r\n";
+static uint32_t eventKey(const char * event){
+  if(event == nullptr)
+    return 0;
+  //FNV-1a, 0 is reserved for unnamed events
+  uint32_t h = 2166136261UL;
+  while(*event){
+    h ^= (uint8_t)*event++;
+    h *= 16777619UL;
   }
+  return h ? h : 1;
+}
 
-  if (id) {
-    ev += "id: ";
-    ev += String(id);
-    ev += "\r\n";
-  }
+//length of the line break at p: "\r\n" and "\n\r" count as one break, as does a lone '\r' or '\n'
+static inline size_t eventLineBreak(const char * p, const char * end){
+  if(*p != '\r' && *p != '\n')
+    return 0;
+  if((p + 1) < end && (p[1] == '\r' || p[1] == '\n') && p[1] != *p)
+    return 2;
+  return 1;
+}
 
-  if (event != nullptr) {
-    ev += "event: ";
-    ev += String(event);
-    ev += "\r\n";
-  }
+static size_t eventFieldLength(const char * name, uint32_t value){
+  char num[11];
+  return strlen(name) + strlen(ultoa(value, num, 10)) + 2;
+}
+
+static char * eventWriteField(char * out, const char * name, uint32_t value){
+  size_t len = strlen(name);
+  memcpy(out, name, len);
+  out += len;
+  ultoa(value, out, 10);
+  out += strlen(out);
+  *out++ = '\r';
+  *out++ = '\n';
+  return out;
+}
 
+static char * eventWrite(char * out, const char * data, size_t len){
+  memcpy(out, data, len);
+  return out + len;
+}
+
+//serializes an event in two passes: the first one sizes the output exactly, the second
+//writes the fields straight into the payload shared by all clients
+static AsyncEventSourcePayload * generateEventMessage(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+  size_t len = 0;
+  if (reconnect)
+    len += eventFieldLength("retry: ", reconnect);
+  if (id)
+    len += eventFieldLength("id: ", id);
+  if (event != nullptr)
+    len += 7 + strlen(event) + 2;
+
+  size_t messageLen = 0;
+  size_t lines = 0;
+  bool multiline = false;
   if (message != nullptr) {
-    size_t messageLen = strlen(message);
-    const char * lineStart = message;
-    char* lineEnd;
-    do {
-      char* nextN = strchr(lineStart, '\n');
-      char* nextR = strchr(lineStart, '\r');
-      if (nextN == nullptr && nextR == nullptr) {
-        size_t llen = ((message + messageLen) - lineStart);
-        std::unique_ptr<char[]> ldata(new char[llen + 1]);
-        if (ldata != nullptr) {
-          memcpy(ldata.get(), lineStart, llen);
-          ldata[llen] = 0;
-          ev += "data: ";
-          ev += ldata.get();
-          ev += "\r\n\r\n";
-        }
-        lineStart = (message + messageLen);
-      } else {
-        char* nextLine = nullptr;
-        if (nextN != nullptr && nextR != nullptr) {
-          if (nextR < nextN) {
-            lineEnd = nextR;
-            if (nextN == (nextR + 1))
-              nextLine = nextN + 1;
-            else
-              nextLine = nextR + 1;
-          } else {
-            lineEnd = nextN;
-            if (nextR == (nextN + 1))
-              nextLine = nextR + 1;
-            else
-              nextLine = nextN + 1;
-          }
-        } else if (nextN != nullptr) {
-          lineEnd = nextN;
-          nextLine = nextN + 1;
+    messageLen = strlen(message);
+    const char * end = message + messageLen;
+    multiline = memchr(message, '\n', messageLen) != nullptr || memchr(message, '\r', messageLen) != nullptr;
+    size_t breakBytes = 0;
+    if (multiline) {
+      //a trailing line break does not open another data line
+      const char * p = message;
+      bool lineOpen = true;
+      while (p < end) {
+        size_t b = eventLineBreak(p, end);
+        if (b) {
+          lines++;
+          breakBytes += b;
+          p += b;
+          lineOpen = (p < end);
         } else {
-          lineEnd = nextR;
-          nextLine = nextR + 1;
+          p++;
         }
+      }
+      if (lineOpen)
+        lines++;
+    } else {
+      lines = 1;
+    }
+    len += (lines * 8) + (messageLen - breakBytes) + 2;
+  }
 
-        size_t llen = lineEnd - lineStart;
-        std::unique_ptr<char[]> ldata(new char[llen + 1]);
-        if (ldata != nullptr) {
-          memcpy(ldata.get(), lineStart, llen);
-          ldata[llen] = 0;
-          ev += "data: ";
-          ev += ldata.get();
-          ev += "\r\n";
+  AsyncEventSourcePayload * payload = AsyncEventSourcePayload::create(len);
+  if (payload == nullptr)
+    return nullptr;
+  payload->key(eventKey(event));
+  char * out = (char *)payload->data();
+
+  if (reconnect)
+    out = eventWriteField(out, "retry: ", reconnect);
+  if (id)
+    out = eventWriteField(out, "id: ", id);
+  if (event != nullptr) {
+    out = eventWrite(out, "event: ", 7);
+    out = eventWrite(out, event, strlen(event));
+    out = eventWrite(out, "\r\n", 2);
+  }
+
+  if (message != nullptr) {
+    if (!multiline) {
+      out = eventWrite(out, "data: ", 6);
+      out = eventWrite(out, message, messageLen);
+      out = eventWrite(out, "\r\n", 2);
+    } else {
+      const char * end = message + messageLen;
+      const char * lineStart = message;
+      const char * p = message;
+      while (p < end) {
+        size_t b = eventLineBreak(p, end);
+        if (!b) {
+          p++;
+          continue;
         }
-        lineStart = nextLine;
-        if (lineStart == (message + messageLen))
-          ev += "\r\n";
+        out = eventWrite(out, "data: ", 6);
+        out = eventWrite(out, lineStart, p - lineStart);
+        out = eventWrite(out, "\r\n", 2);
+        p += b;
+        lineStart = p;
       }
-    } while (lineStart < (message + messageLen));
+      if (lineStart < end) {
+        out = eventWrite(out, "data: ", 6);
+        out = eventWrite(out, lineStart, end - lineStart);
+        out = eventWrite(out, "\r\n", 2);
+      }
+    }
+    out = eventWrite(out, "\r\n", 2);
   }
 
-  return ev;
+  return payload;
+}
+
+// Payload
+
+AsyncEventSourcePayload * AsyncEventSourcePayload::create(size_t len){
+  void * mem = malloc(sizeof(AsyncEventSourcePayload) + len + 1);
+  if(mem == nullptr)
+    return nullptr;
+  AsyncEventSourcePayload * payload = new (mem) AsyncEventSourcePayload(len);
+  payload->data()[len] = 0;
+  return payload;
+}
+
+AsyncEventSourcePayload * AsyncEventSourcePayload::create(const char * data, size_t len){
+  AsyncEventSourcePayload * payload = create(len);
+  if(payload != nullptr)
+    memcpy(payload->data(), data, len);
+  return payload;
+}
+
+void AsyncEventSourcePayload::retain(){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  __atomic_add_fetch(&_refs, 1, __ATOMIC_RELAXED);
+#else
+  _refs++;
+#endif
+}
+
+void AsyncEventSourcePayload::release(){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  if(__atomic_sub_fetch(&_refs, 1, __ATOMIC_ACQ_REL) != 0)
+    return;
+#else
+  if(!_refs || --_refs != 0)
+    return;
+#endif
+  this->~AsyncEventSourcePayload();
+  free(this);
 }
 
 // Message
 
 AsyncEventSourceMessage::AsyncEventSourceMessage(const char * data, size_t len)
-: _data(nullptr), _len(len), _sent(0), _acked(0)
+: _payload(nullptr), _len(0), _sent(0), _acked(0)
+{
+  _payload = AsyncEventSourcePayload::create(data, len);
+  if(_payload != nullptr)
+    _len = len;
+}
+
+AsyncEventSourceMessage::AsyncEventSourceMessage(AsyncEventSourcePayload * payload)
+: _payload(payload), _len(0), _sent(0), _acked(0)
 {
-  _data = new uint8_t[_len + 1];
-  if(_data == nullptr){
-    _len = 0;
-  } else {
-    memcpy(_data, data, len);
-    _data[_len] = 0;
+  if(_payload != nullptr){
+    _payload->retain();
+    _len = _payload->length();
   }
 }
 
 AsyncEventSourceMessage::~AsyncEventSourceMessage() {
-     if(_data != nullptr)
-        delete[] _data;
+     if(_payload != nullptr)
+        _payload->release();
 }
 
 size_t AsyncEventSourceMessage::ack(size_t len, uint32_t time) {
@@ -135,24 +230,106 @@ size_t AsyncEventSourceMessage::ack(size_t len, uint32_t time) {
 }
 
 size_t AsyncEventSourceMessage::send(AsyncClient *client) {
-  const size_t len = _len - _sent;
-  if(client->space() < len){
+  size_t len = _len - _sent;
+  size_t space = client->space();
+  if(len > space)
+    len = space;
+  if(!len)
     return 0;
-  }
-  size_t sent = client->add((const char *)_data, len);
-  if(client->canSend())
-    client->send();
+  size_t sent = client->add((const char *)_payload->data() + _sent, len);
   _sent += sent;
   return sent; 
 }
 
+// History
+
+AsyncEventSourceHistory::AsyncEventSourceHistory()
+: _entries(nullptr), _capacity(0), _maxBytes(0), _head(0), _count(0), _bytes(0)
+{}
+
+AsyncEventSourceHistory::~AsyncEventSourceHistory(){
+  begin(0, 0);
+}
+
+bool AsyncEventSourceHistory::begin(size_t events, size_t bytes){
+  clear();
+  if(_entries != nullptr)
+    free(_entries);
+  _entries = nullptr;
+  _capacity = 0;
+  _maxBytes = bytes;
+  if(!events || !bytes)
+    return true;
+  _entries = (Entry *)malloc(events * sizeof(Entry));
+  if(_entries == nullptr)
+    return false;
+  _capacity = events;
+  return true;
+}
+
+void AsyncEventSourceHistory::_dropOldest(){
+  Entry & e = _at(0);
+  _bytes -= e.payload->length();
+  e.payload->release();
+  e.payload = nullptr;
+  _head = (_head + 1) % _capacity;
+  _count--;
+}
+
+void AsyncEventSourceHistory::clear(){
+  while(_count)
+    _dropOldest();
+  _head = 0;
+}
+
+void AsyncEventSourceHistory::add(uint32_t id, AsyncEventSourcePayload * payload){
+  if(!_capacity || !id || payload == nullptr || payload->length() > _maxBytes)
+    return;
+  //ids are expected to grow, a smaller one means the sender restarted its sequence
+  if(_count && id <= _at(_count - 1).id)
+    clear();
+  while(_count && (_count == _capacity || (_bytes + payload->length()) > _maxBytes))
+    _dropOldest();
+  payload->retain();
+  Entry & e = _at(_count);
+  e.id = id;
+  e.payload = payload;
+  _bytes += payload->length();
+  _count++;
+}
+
+size_t AsyncEventSourceHistory::replay(AsyncEventSourceClient * client, uint32_t lastId){
+  if(!_count || !lastId)
+    return 0;
+  //binary search for the first entry newer than lastId
+  size_t lo = 0, hi = _count;
+  while(lo < hi){
+    size_t mid = (lo + hi) / 2;
+    if(_at(mid).id <= lastId)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  for(size_t i = lo; i < _count; i++)
+    client->write(_at(i).payload);
+  return _count - lo;
+}
+
 // Client
 
 AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server)
 : _messageQueue(LinkedList<AsyncEventSourceMessage *>([](AsyncEventSourceMessage *m){ delete  m; }))
+, _queuedBytes(0)
+, _droppedEvents(0)
+, _coalescedEvents(0)
+, _unackedSince(0)
+, _inflight(0)
 {
   _client = request->client();
   _server = server;
+  _maxQueuedBytes = _server->queueLimit();
+  _queuePolicy = _server->queuePolicy();
+  _lastWrite = millis();
   _lastId = 0;
   if(request->hasHeader(F("Last-Event-ID")))
     _lastId = atoi(request->getHeader(F("Last-Event-ID"))->value().c_str());
@@ -170,10 +347,31 @@ AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, A
 }
 
 AsyncEventSourceClient::~AsyncEventSourceClient(){
+  AWS_METRIC(sseQueuedBytes.add(-(int32_t)_queuedBytes));
    _messageQueue.free();
   close();
 }
 
+void AsyncEventSourceClient::_removeMessage(AsyncEventSourceMessage *dataMessage){
+  _queuedBytes -= dataMessage->length();
+  AWS_METRIC(sseQueuedBytes.add(-(int32_t)dataMessage->length()));
+  _messageQueue.remove(dataMessage);
+}
+
+bool AsyncEventSourceClient::_dropOldest(){
+  //events already partly on the wire have to be completed
+  for(const auto& m: _messageQueue){
+    if(!m->started()){
+      AsyncEventSourceMessage * stale = m;
+      _removeMessage(stale);
+      _droppedEvents++;
+      _server->_handleDrop(false);
+      return true;
+    }
+  }
+  return false;
+}
+
 void AsyncEventSourceClient::_queueMessage(AsyncEventSourceMessage *dataMessage){
   if(dataMessage == NULL)
     return;
@@ -182,24 +380,69 @@ void AsyncEventSourceClient::_queueMessage(AsyncEventSourceMessage *dataMessage)
     return;
   }
 
+  AsyncWebLockGuard l(_lockmq);
+
+  size_t len = dataMessage->length();
+  if(_queuePolicy == SSE_QUEUE_COALESCE && dataMessage->key()){
+    //only the latest event of a name is worth sending
+    uint32_t key = dataMessage->key();
+    for(const auto& m: _messageQueue){
+      if(m->key() == key && !m->started()){
+        AsyncEventSourceMessage * stale = m;
+        _removeMessage(stale);
+        _coalescedEvents++;
+        _server->_handleDrop(true);
+        break;
+      }
+    }
+  }
+  if(_queuePolicy == SSE_QUEUE_DROP_OLDEST){
+    while(!_messageQueue.isEmpty() && (_queuedBytes + len) > _maxQueuedBytes && _dropOldest());
+  }
+  if(!_messageQueue.isEmpty() && (_queuedBytes + len) > _maxQueuedBytes){
+    delete dataMessage;
+    _droppedEvents++;
+    _server->_handleDrop(false);
+    return;
+  }
+
   _messageQueue.add(dataMessage);
+  _queuedBytes += len;
+  AWS_METRIC(sseQueuedBytes.add(len));
 
   _runQueue();
 }
 
 void AsyncEventSourceClient::_onAck(size_t len, uint32_t time){
+  //before taking _lockmq, the server lock is always taken first
+  _server->_drainPublishQueue();
+  AsyncWebLockGuard l(_lockmq);
+  //any progress restarts the ack deadline
+  _inflight = (len < _inflight) ? (_inflight - len) : 0;
+  _unackedSince = millis();
   while(len && !_messageQueue.isEmpty()){
     len = _messageQueue.front()->ack(len, time);
     if(_messageQueue.front()->finished())
-      _messageQueue.remove(_messageQueue.front());
+      _removeMessage(_messageQueue.front());
   }
 
   _runQueue();
 }
 
 void AsyncEventSourceClient::_onPoll(){
+  uint32_t now = millis();
+  uint32_t ackTimeout = _server->ackTimeout();
+  if(_inflight && ackTimeout && (now - _unackedSince) >= ackTimeout){
+    //the peer stopped acknowledging, it is gone or hopelessly slow
+    _client->close(true);
+    return;
+  }
+  _server->_drainPublishQueue();
+  AsyncWebLockGuard l(_lockmq);
   if(!_messageQueue.isEmpty()){
     _runQueue();
+  } else if(_server->heartbeatInterval() && (now - _lastWrite) >= _server->heartbeatInterval()){
+    write(_server->_heartbeatPayload());
   }
 }
 
@@ -209,7 +452,11 @@ void AsyncEventSourceClient::_onTimeout(uint32_t time __attribute__((unused))){
 }
 
 void AsyncEventSourceClient::_onDisconnect(){
-  _client = NULL;
+  {
+    //an application task may be writing to the socket right now
+    AsyncWebLockGuard l(_lockmq);
+    _client = NULL;
+  }
   _server->_handleDisconnect(this);
 }
 
@@ -222,20 +469,43 @@ void AsyncEventSourceClient::write(const char * message, size_t len){
   _queueMessage(new AsyncEventSourceMessage(message, len));
 }
 
+void AsyncEventSourceClient::write(AsyncEventSourcePayload * payload){
+  _queueMessage(new AsyncEventSourceMessage(payload));
+}
+
 void AsyncEventSourceClient::send(const char *message, const char *event, uint32_t id, uint32_t reconnect){
-  String ev = generateEventMessage(message, event, id, reconnect);
-  _queueMessage(new AsyncEventSourceMessage(ev.c_str(), ev.length()));
+  AsyncEventSourcePayload * payload = generateEventMessage(message, event, id, reconnect);
+  if(payload == nullptr)
+    return;
+  write(payload);
+  payload->release();
 }
 
 void AsyncEventSourceClient::_runQueue(){
   while(!_messageQueue.isEmpty() && _messageQueue.front()->finished()){
-    _messageQueue.remove(_messageQueue.front());
+    _removeMessage(_messageQueue.front());
   }
+  if(_client == NULL)
+    return;
 
+  //fill the send window with as many queued events as fit and push them out together.
+  //only the events waiting for their ack are skipped, the walk stops at the first one that does not fit
+  size_t added = 0;
   for(auto i = _messageQueue.begin(); i != _messageQueue.end(); ++i)
   {
+    if((*i)->sent())
+      continue;
+    added += (*i)->send(_client);
     if(!(*i)->sent())
-      (*i)->send(_client);
+      break;
+  }
+  if(added){
+    if(!_inflight)
+      _unackedSince = millis();
+    _inflight += added;
+    _lastWrite = millis();
+    if(_client->canSend())
+      _client->send();
   }
 }
 
@@ -246,15 +516,36 @@ AsyncEventSource::AsyncEventSource(const String& url)
   : _url(url)
   , _clients(LinkedList<AsyncEventSourceClient *>([](AsyncEventSourceClient *c){ delete c; }))
   , _connectcb(NULL)
+  , _iterating(0)
+  , _pendingRemoval(false)
+  , _maxQueuedBytes(SSE_MAX_QUEUED_BYTES)
+  , _queuePolicy(SSE_QUEUE_DROP_NEWEST)
+  , _droppedEvents(0)
+  , _coalescedEvents(0)
+  , _heartbeatInterval(0)
+  , _ackTimeout(0)
+  , _heartbeat(nullptr)
+  , _publishQueue(SSE_PUBLISH_QUEUE_LENGTH)
 {}
 
 AsyncEventSource::~AsyncEventSource(){
   close();
+  ArEventPublishEntry entry;
+  while(_publishQueue.pop(entry))
+    entry.payload->release();
+  if(_heartbeat != nullptr)
+    _heartbeat->release();
+}
+
+void AsyncEventSource::heartbeat(uint32_t interval, uint32_t ackTimeout){
+  _heartbeatInterval = interval * 1000;
+  _ackTimeout = ackTimeout * 1000;
+  //one comment frame shared by every client queue
+  if(_heartbeatInterval && _heartbeat == nullptr)
+    _heartbeat = AsyncEventSourcePayload::create(":\n\n", 3);
 }
 
 void AsyncEventSource::onConnect(ArEventHandlerFunction cb){
-   if(_clients.isEmpty())
-   _semaphore = false;
   _connectcb = cb;
 }
 
@@ -272,45 +563,117 @@ void AsyncEventSource::_addClient(AsyncEventSourceClient * client){
     free(temp);
   }*/
   
-  if(!_semaphore){
-      _clients.add(client);
-      if(_connectcb)
-      _connectcb(client);
-  }    
+  //queued events go to the clients that were there when they were sent
+  _drainPublishQueue();
+  {
+    AsyncWebLockGuard l(_client_queue_lock);
+    _clients.add(client);
+    AWS_METRIC(sseClients.inc());
+    //events missed while reconnecting go out before anything new
+    _history.replay(client, client->lastId());
+  }
+  //outside the lock, the callback may send or publish from here
+  if(_connectcb)
+    _connectcb(client);
 }
 
 void AsyncEventSource::_handleDisconnect(AsyncEventSourceClient * client){
-  _semaphore = true;
+  AsyncWebLockGuard l(_client_queue_lock);
+  AWS_METRIC(sseClients.dec());
+  if(_iterating){
+    //the list is being walked further up the stack of this task, remove the client afterwards
+    _pendingRemoval = true;
+    return;
+  }
   _clients.remove(client);
-  _semaphore = false;
 }
 
-inline void AsyncEventSource::close(){
-
+void AsyncEventSource::_forEachClient(std::function<void(AsyncEventSourceClient *)> fn){
+  AsyncWebLockGuard l(_client_queue_lock);
+  _iterating++;
   for(const auto &c: _clients){
-    if(c->connected())   
-      _semaphore = true;
-      c->close();
+    fn(c);
   }
+  _iterating--;
+  if(!_iterating && _pendingRemoval){
+    _pendingRemoval = false;
+    while(_clients.remove_first([](AsyncEventSourceClient *c){ return c->client() == NULL; }));
+  }
+}
+
+void AsyncEventSource::close(){
+  _forEachClient([](AsyncEventSourceClient *c){
+    if(c->connected())
+      c->close();
+  });
 }
 
 void AsyncEventSource::send(const char *message, const char *event, uint32_t id, uint32_t reconnect){
-  if(_clients.isEmpty()){
-    _semaphore = false;
+  if(_clients.isEmpty() && (!id || !_history.enabled()))
     return;
-  }    
 
-  String ev = generateEventMessage(message, event, id, reconnect);
-  for(const auto &c: _clients){
-    if(c->connected()) {
-      if(!_semaphore){
-      c->write(ev.c_str(), ev.length());
-      }
+  //serialized outside of any lock, one copy of the event for all clients
+  AsyncEventSourcePayload * payload = generateEventMessage(message, event, id, reconnect);
+  if(payload == nullptr)
+    return;
+  _deliver(payload, id);
+  payload->release();
+}
+
+void AsyncEventSource::_deliver(AsyncEventSourcePayload * payload, uint32_t id){
+  {
+    AsyncWebLockGuard l(_client_queue_lock);
+    _history.add(id, payload);
+  }
+  _forEachClient([payload](AsyncEventSourceClient *c){
+    if(c->connected())
+      c->write(payload);
+  });
+}
+
+bool AsyncEventSource::trySend(const char *message, const char *event, uint32_t id, uint32_t reconnect){
+  bool noClients = _clients.isEmpty();
+  if(noClients && (!id || !_history.enabled()))
+    return true;
+  AsyncEventSourcePayload * payload = generateEventMessage(message, event, id, reconnect);
+  if(payload == nullptr)
+    return false;
+  //without clients nothing drains the queue on the network task. if the lock is free right now
+  //the queue and this event go into the history from here, in the order they were sent
+  if(noClients && _client_queue_lock.tryLock()){
+    bool delivered = _clients.isEmpty();
+    if(delivered){
+      _drainPublishQueue();
+      _deliver(payload, id);
+    }
+    _client_queue_lock.unlock();
+    if(delivered){
+      payload->release();
+      return true;
     }
   }
+  ArEventPublishEntry entry;
+  entry.payload = payload;
+  entry.id = id;
+  if(!_publishQueue.push(entry)){
+    payload->release();
+    return false;
+  }
+  return true;
+}
+
+void AsyncEventSource::_drainPublishQueue(){
+  //popped under the lock, trySend() may drain from another task while no client is connected
+  AsyncWebLockGuard l(_client_queue_lock);
+  ArEventPublishEntry entry;
+  while(_publishQueue.pop(entry)){
+    _deliver(entry.payload, entry.id);
+    entry.payload->release();
+  }
 }
 
 size_t AsyncEventSource::count() const {
+  AsyncWebLockGuard l(_client_queue_lock);
   return _clients.count_if([](AsyncEventSourceClient *c){
     return c->connected();
   });
@@ -325,11 +688,9 @@ bool AsyncEventSource::canHandle(AsyncWebServerRequest *request){
 }
 
 void AsyncEventSource::handleRequest(AsyncWebServerRequest *request){
-  if(!_semaphore){
   if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
     return request->requestAuthentication();
   request->send(new AsyncEventSourceResponse(this));
-  }
 }
 
 // Response
@@ -21,32 +21,118 @@
 #define ASYNCEVENTSOURCE_H_
 
 #include <Arduino.h>
-#ifdef ESP32
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
 #include <AsyncTCP.h>
 #else
 #include <ESPAsyncTCP.h>
 #endif
 #include <ESPAsyncWebServer.h>
+#include "AsyncWebSynchronization.h"
+#include "AsyncWebPublishQueue.h"
+
+//default per client cap for queued event bytes
+#ifndef SSE_MAX_QUEUED_BYTES
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+#define SSE_MAX_QUEUED_BYTES 16384
+#else
+#define SSE_MAX_QUEUED_BYTES 8192
+#endif
+#endif
+
+//seconds sent data may stay unacknowledged before the client is closed
+#ifndef SSE_ACK_TIMEOUT
+#define SSE_ACK_TIMEOUT 30
+#endif
+
+//events other tasks may have in flight to the network task, see AsyncEventSource::trySend()
+#ifndef SSE_PUBLISH_QUEUE_LENGTH
+#define SSE_PUBLISH_QUEUE_LENGTH 16
+#endif
+
+//what to do with an event that does not fit in the queue of a client
+typedef enum { SSE_QUEUE_DROP_NEWEST, SSE_QUEUE_DROP_OLDEST, SSE_QUEUE_COALESCE } ArEventQueuePolicy;
 
 class AsyncEventSource;
 class AsyncEventSourceResponse;
 class AsyncEventSourceClient;
 typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
 
+//immutable event text shared by the queues of all clients, freed with the last reference
+class AsyncEventSourcePayload {
+  private:
+    size_t _len;
+    uint32_t _refs;
+    uint32_t _key;
+    AsyncEventSourcePayload(size_t len): _len(len), _refs(1), _key(0) {}
+  public:
+    //object and text live in one allocation. the payload starts with one reference
+    static AsyncEventSourcePayload * create(size_t len);
+    static AsyncEventSourcePayload * create(const char * data, size_t len);
+    uint8_t * data(){ return (uint8_t *)(this + 1); }
+    size_t length() const { return _len; }
+    uint32_t refs() const { return _refs; }
+    //hash of the event name, 0 for unnamed events
+    uint32_t key() const { return _key; }
+    void key(uint32_t k){ _key = k; }
+    //references are taken and dropped from the network task and from application tasks
+    void retain();
+    void release();
+};
+
+//serialized event handed from an application task to the network task
+typedef struct {
+    AsyncEventSourcePayload * payload;
+    uint32_t id;
+} ArEventPublishEntry;
+
 class AsyncEventSourceMessage {
   private:
-    uint8_t * _data; 
+    AsyncEventSourcePayload * _payload;
     size_t _len;
     size_t _sent;
     //size_t _ack;
     size_t _acked; 
   public:
     AsyncEventSourceMessage(const char * data, size_t len);
+    AsyncEventSourceMessage(AsyncEventSourcePayload * payload);
     ~AsyncEventSourceMessage();
     size_t ack(size_t len, uint32_t time __attribute__((unused)));
+    //adds as much of the event as fits in the send window, the caller pushes it out
     size_t send(AsyncClient *client);
     bool finished(){ return _acked == _len; }
     bool sent() { return _sent == _len; }
+    bool started() const { return _sent != 0; }
+    size_t length() const { return _len; }
+    uint32_t key() const { return _payload ? _payload->key() : 0; }
+};
+
+//ring of the latest serialized events with an id, replayed to clients reconnecting with Last-Event-ID
+class AsyncEventSourceHistory {
+  private:
+    typedef struct {
+      uint32_t id;
+      AsyncEventSourcePayload * payload;
+    } Entry;
+    Entry * _entries;
+    size_t _capacity;
+    size_t _maxBytes;
+    size_t _head;
+    size_t _count;
+    size_t _bytes;
+    Entry & _at(size_t i){ return _entries[(_head + i) % _capacity]; }
+    void _dropOldest();
+  public:
+    AsyncEventSourceHistory();
+    ~AsyncEventSourceHistory();
+    //keeps up to events entries and bytes of event text. 0 disables the history
+    bool begin(size_t events, size_t bytes);
+    void clear();
+    bool enabled() const { return _capacity != 0; }
+    size_t count() const { return _count; }
+    size_t bytes() const { return _bytes; }
+    void add(uint32_t id, AsyncEventSourcePayload * payload);
+    //queues every stored event with an id newer than lastId
+    size_t replay(AsyncEventSourceClient * client, uint32_t lastId);
 };
 
 class AsyncEventSourceClient {
@@ -55,7 +141,19 @@ class AsyncEventSourceClient {
     AsyncEventSource *_server;
     uint32_t _lastId;
     LinkedList<AsyncEventSourceMessage *> _messageQueue;
+    size_t _queuedBytes;
+    size_t _maxQueuedBytes;
+    ArEventQueuePolicy _queuePolicy;
+    uint32_t _droppedEvents;
+    uint32_t _coalescedEvents;
+    uint32_t _lastWrite;
+    uint32_t _unackedSince;
+    size_t _inflight;
+    //guards the message queue, events are queued from any task and sent from the network task
+    AsyncWebLock _lockmq;
     void _queueMessage(AsyncEventSourceMessage *dataMessage);
+    void _removeMessage(AsyncEventSourceMessage *dataMessage);
+    bool _dropOldest();
     void _runQueue();
 
   public:
@@ -66,10 +164,21 @@ class AsyncEventSourceClient {
     AsyncClient* client(){ return _client; }
     void close();
     void write(const char * message, size_t len);
+    void write(AsyncEventSourcePayload * payload);
     void send(const char *message, const char *event=NULL, uint32_t id=0, uint32_t reconnect=0);
     bool connected() const { return (_client != NULL) && _client->connected(); }
     uint32_t lastId() const { return _lastId; }
 
+    //queue cap in bytes, a single event larger than the cap is still accepted into an empty queue
+    void queueLimit(size_t maxBytes){ _maxQueuedBytes = maxBytes; }
+    size_t queueLimit() const { return _maxQueuedBytes; }
+    void queuePolicy(ArEventQueuePolicy policy){ _queuePolicy = policy; }
+    ArEventQueuePolicy queuePolicy() const { return _queuePolicy; }
+    size_t queuedBytes() const { return _queuedBytes; }
+    size_t queuedEvents() const { return _messageQueue.length(); }
+    uint32_t droppedEvents() const { return _droppedEvents; }
+    uint32_t coalescedEvents() const { return _coalescedEvents; }
+
     //system callbacks (do not call)
     void _onAck(size_t len, uint32_t time);
     void _onPoll(); 
@@ -80,9 +189,23 @@ class AsyncEventSourceClient {
 class AsyncEventSource: public AsyncWebHandler {
   private:
     String _url;
-    bool _semaphore = false;
     LinkedList<AsyncEventSourceClient *> _clients;
     ArEventHandlerFunction _connectcb;
+    //guards _clients against the network task and application tasks on the other core
+    AsyncWebLock _client_queue_lock;
+    uint32_t _iterating;
+    bool _pendingRemoval;
+    void _forEachClient(std::function<void(AsyncEventSourceClient *)> fn);
+    size_t _maxQueuedBytes;
+    ArEventQueuePolicy _queuePolicy;
+    uint32_t _droppedEvents;
+    uint32_t _coalescedEvents;
+    AsyncEventSourceHistory _history;
+    uint32_t _heartbeatInterval;
+    uint32_t _ackTimeout;
+    AsyncEventSourcePayload * _heartbeat;
+    AsyncWebPublishQueue<ArEventPublishEntry> _publishQueue;
+    void _deliver(AsyncEventSourcePayload * payload, uint32_t id);
   public:
     AsyncEventSource(const String& url);
     ~AsyncEventSource();
@@ -93,9 +216,41 @@ class AsyncEventSource: public AsyncWebHandler {
     void send(const char *message, const char *event=NULL, uint32_t id=0, uint32_t reconnect=0);
     size_t count() const; //number clinets connected
 
+    //does not wait for the client list or block behind the network task. the event is serialized
+    //by the caller and queued for the network task. false if the queue is full (nothing is sent)
+    bool trySend(const char *message, const char *event=NULL, uint32_t id=0, uint32_t reconnect=0);
+    size_t publishQueueLength() const { return _publishQueue.length(); }
+    size_t publishQueueCapacity() const { return _publishQueue.capacity(); }
+    //events refused because the queue was full
+    uint32_t publishRejected() const { return _publishQueue.rejected(); }
+
+    //queue defaults for new clients, see AsyncEventSourceClient::queueLimit()
+    void queueLimit(size_t maxBytes){ _maxQueuedBytes = maxBytes; }
+    size_t queueLimit() const { return _maxQueuedBytes; }
+    void queuePolicy(ArEventQueuePolicy policy){ _queuePolicy = policy; }
+    ArEventQueuePolicy queuePolicy() const { return _queuePolicy; }
+    //events dropped or replaced in the queues of all clients since start
+    uint32_t droppedEvents() const { return _droppedEvents; }
+    uint32_t coalescedEvents() const { return _coalescedEvents; }
+
+    //keep the last events (up to maxEvents and maxBytes) that were sent with an id and replay
+    //them to clients that reconnect with Last-Event-ID. disabled if zero (default)
+    bool replayBuffer(size_t maxEvents, size_t maxBytes){ return _history.begin(maxEvents, maxBytes); }
+    size_t replayEvents() const { return _history.count(); }
+    size_t replayBytes() const { return _history.bytes(); }
+
+    //send a comment to clients that were idle for interval seconds, and close clients whose data
+    //stays unacknowledged for ackTimeout seconds. disabled if zero (default)
+    void heartbeat(uint32_t interval, uint32_t ackTimeout=SSE_ACK_TIMEOUT);
+    uint32_t heartbeatInterval() const { return _heartbeatInterval; }
+    uint32_t ackTimeout() const { return _ackTimeout; }
+
     //system callbacks (do not call)
     void _addClient(AsyncEventSourceClient * client);
     void _handleDisconnect(AsyncEventSourceClient * client);
+    void _handleDrop(bool coalesced){ if(coalesced) _coalescedEvents++; else _droppedEvents++; AWS_METRIC(sseDropped.inc()); }
+    AsyncEventSourcePayload * _heartbeatPayload(){ return _heartbeat; }
+    void _drainPublishQueue();
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 };
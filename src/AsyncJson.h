@@ -4,12 +4,16 @@
 #include <StringUtils.h>
 #include <ESPAsyncWebServer.h>
 #include <GSON.h>
-#include <Ticker.h>
 
 constexpr const char* JSON_MIMETYPE = "application/json";
 
+// bytes handed to AsyncCallbackJsonWebHandler2 per scheduler step, 0 for the whole body at once
 #ifndef CHUNK_OBJ_SIZE
+#ifdef ESP8266
 #define CHUNK_OBJ_SIZE 768
+#else
+#define CHUNK_OBJ_SIZE 0
+#endif
 #endif
 
 class Move {
@@ -65,9 +69,10 @@ class AsyncJsonResponse : public AsyncAbstractResponse {
 protected:
     gson::string _jsonBuffer;
     bool _isValid;
+    size_t _readLength;
 
 public:
-    AsyncJsonResponse() : _isValid{ false } {
+    AsyncJsonResponse() : _isValid{ false }, _readLength(0) {
         _code = 200;
         _contentType = JSON_MIMETYPE;
     }
@@ -84,12 +89,93 @@ public:
     size_t getSize() { return _jsonBuffer.s.length(); }
 
     size_t _fillBuffer(uint8_t *data, size_t len) {
-        ChunkPrint dest(data, _sentLength, len);
-        dest.write(reinterpret_cast<const uint8_t*>(_jsonBuffer.s.c_str()), _jsonBuffer.s.length());
+        size_t length = _jsonBuffer.s.length();
+        size_t left = (length > _readLength) ? length - _readLength : 0;
+        if (len > left)
+            len = left;
+        memcpy(data, _jsonBuffer.s.c_str() + _readLength, len);
+        _readLength += len;
         return len;
     }
 };
 
+// writes into the send buffer, what does not fit is kept for the next one
+class JsonSendPrint : public Print {
+private:
+    uint8_t* _destination;
+    size_t _room;
+    size_t _pos;
+    String& _spill;
+public:
+    JsonSendPrint(uint8_t* destination, size_t len, String& spill)
+        : _destination(destination), _room(len), _pos(0), _spill(spill) {}
+    virtual ~JsonSendPrint() {}
+    size_t written() const { return _pos; }
+    bool full() const { return _pos == _room; }
+    size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+    size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = std::min(size, _room - _pos);
+        memcpy(_destination + _pos, buffer, n);
+        _pos += n;
+        if (n < size)
+            _spill.concat((const char*)buffer + n, size - n);
+        return size;
+    }
+};
+
+// writes piece number step of the document into out, returns false after the last piece.
+// pieces should be small (an object of an array), they are written straight into the send buffer
+typedef std::function<bool(Print &out, size_t step)> ArJsonGeneratorFunction;
+
+// a document that is generated while it is sent, it is never held in memory as a whole
+class AsyncJsonStreamResponse : public AsyncAbstractResponse {
+protected:
+    ArJsonGeneratorFunction _generator;
+    size_t _step;
+    bool _done;
+    String _spill;
+    size_t _spillPos;
+
+public:
+    AsyncJsonStreamResponse(ArJsonGeneratorFunction generator, int code = 200)
+        : _generator(generator), _step(0), _done(false), _spillPos(0) {
+        _code = code;
+        _contentType = JSON_MIMETYPE;
+        _sendContentLength = false;
+        _chunked = true;
+    }
+
+    bool _sourceValid() const { return !!_generator; }
+
+    void _respond(AsyncWebServerRequest *request) {
+        // HTTP/1.0 has no chunks, the end of the body is the end of the connection
+        if (!request->version())
+            _chunked = false;
+        AsyncAbstractResponse::_respond(request);
+    }
+
+    size_t _fillBuffer(uint8_t *data, size_t len) {
+        size_t written = 0;
+        if (_spillPos < _spill.length()) {
+            written = std::min(len, (size_t)_spill.length() - _spillPos);
+            memcpy(data, _spill.c_str() + _spillPos, written);
+            _spillPos += written;
+            if (_spillPos < _spill.length())
+                return written;
+            _spill = String();
+            _spillPos = 0;
+        }
+        JsonSendPrint out(data + written, len - written, _spill);
+        while (!_done && !out.full() && !_spill.length()) {
+            if (!_generator(out, _step++))
+                _done = true;
+        }
+        return written + out.written();
+    }
+};
+
 typedef std::function<void(AsyncWebServerRequest *request, gson::Entry &json)> ArJsonRequestHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, gson::string &json)> ArJsonRequestHandlerFunction2;
 
@@ -99,14 +185,11 @@ private:
     WebRequestMethodComposite _method;
     ArJsonRequestHandlerFunction _onRequest;
 
-    size_t _contentLength;
     size_t _maxContentLength;
-    void* _tempObject;
-    size_t _tempObjectSize;
 
 public:
     AsyncCallbackJsonWebHandler(const String& uri, ArJsonRequestHandlerFunction onRequest) 
-        : _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest(onRequest), _maxContentLength(8096), _tempObject(nullptr), _tempObjectSize(0) {}
+        : _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest(onRequest), _maxContentLength(8096) {}
 
     void setMethod(WebRequestMethodComposite method) { _method = method; }
     void setMaxContentLength(int maxContentLength) { _maxContentLength = maxContentLength; }
@@ -132,16 +215,9 @@ public:
     virtual void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override final {}
 
     virtual void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) override final {
-        if (_onRequest) {
-            _contentLength = total;
-            if (total > 0 && _tempObject == nullptr && total < _maxContentLength) {
-                _tempObject = malloc(total);
-                _tempObjectSize = total;
-            }
-            if (_tempObject != nullptr) {
-                memcpy(static_cast<uint8_t*>(_tempObject) + index, data, len);
-            }
-        }
+        // the body is kept by the request, overlapping requests do not share it
+        if (_onRequest)
+            request->bufferBody(data, len, index, total, _maxContentLength);
     }
     virtual bool isRequestHandlerTrivial() override final { return _onRequest ? false : true; }
 };
@@ -152,64 +228,27 @@ private:
     WebRequestMethodComposite _method;
     ArJsonRequestHandlerFunction2 _onRequest2;
 
-    size_t _contentLength;
     size_t _maxContentLength;
-    void* _tempObject;
-    size_t _tempObjectSize;
-
-    AsyncWebServerRequest* _request;
-    size_t _index;
-    Ticker _ticker;
-
-    void processNextChunk() {
-
-#ifdef ESP8266        
-        const size_t CHUNK_SIZE = CHUNK_OBJ_SIZE;  // Adjust chunk size
-        if (_index < _tempObjectSize) {
-            size_t chunkLen = (_index + CHUNK_SIZE < _tempObjectSize) ? CHUNK_SIZE : (_tempObjectSize - _index);
-            // Create a unique pointer for the chunk to manage its memory automatically
-            std::unique_ptr<char[]> chunkObject(new char[chunkLen]);
-            memcpy(chunkObject.get(), static_cast<char*>(_tempObject) + _index, chunkLen);
-            // Create a gson::string to hold the raw JSON data chunk
-            gson::string rawJson;
-            rawJson.addTextRaw(chunkObject.get(), chunkLen);
-            // Call the _onRequest2 handler with the chunk
-            _onRequest2(_request, rawJson);
-            // Move to the next chunk
-            _index += chunkLen;
-            // Schedule the next chunk processing
-            _ticker.once_ms(5, [this]() {this->processNextChunk();});
-        } else {
-            // Reset tempObject pointer to release the memory
-            _tempObject = nullptr;
-            _tempObjectSize = 0;
-        }
-        #endif
-        #ifdef ESP32
-        if (_tempObjectSize > 0) {
-        // Create a unique pointer for the entire data object
-        std::unique_ptr<char[]> fullObject(new char[_tempObjectSize]);
-        memcpy(fullObject.get(), _tempObject, _tempObjectSize);
-        // Create a gson::string to hold the raw JSON data
+    size_t _chunkSize;
+
+    // hands the next piece of the body to the callback, true while there is more
+    bool processNextChunk(AsyncWebServerRequest* request, size_t& index) {
+        size_t length = request->bodyLength();
+        size_t chunkLen = (_chunkSize && _chunkSize < length - index) ? _chunkSize : (length - index);
         gson::string rawJson;
-        rawJson.addTextRaw(fullObject.get(), _tempObjectSize);
-        // Call the _onRequest2 handler with the full object
-        _onRequest2(_request, rawJson);
-        // Reset tempObject pointer to release the memory
-        _tempObject = nullptr;
-        _tempObjectSize = 0;
-        }else{
-         // (e.g., log a warning or error if necessary)   
-        }
-        #endif
+        rawJson.addTextRaw(request->body() + index, chunkLen);
+        index += chunkLen;
+        _onRequest2(request, rawJson);
+        return index < length;
     }
 
 public:
     AsyncCallbackJsonWebHandler2(const String& uri, ArJsonRequestHandlerFunction2 onRequest) 
-        : _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest2(onRequest), _maxContentLength(16384), _tempObject(nullptr), _tempObjectSize(0) {}
+        : _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest2(onRequest), _maxContentLength(16384), _chunkSize(CHUNK_OBJ_SIZE) {}
     
     void setMethod(WebRequestMethodComposite method) { _method = method; }
     void setMaxContentLength(int maxContentLength) { _maxContentLength = maxContentLength; }
+    void setChunkSize(size_t chunkSize) { _chunkSize = chunkSize; }
     void onRequest2(ArJsonRequestHandlerFunction2 fn) { _onRequest2 = fn; }
 
     virtual bool canHandle(AsyncWebServerRequest *request) override final {
@@ -231,14 +270,15 @@ public:
 
     virtual void handleRequest(AsyncWebServerRequest *request) override final {
         if (_onRequest2) {
-            if (_tempObject != nullptr && _tempObjectSize > 0) {
-                _request = request;
-                _index = 0;
-                processNextChunk();  // Start processing the first chunk
-            } else {
-                // No temporary object to process
-                request->send(_contentLength > _maxContentLength ? 413 : 400);
+            if (request->bodyLength() == 0) {
+                // nothing was buffered
+                request->send(request->contentLength() > _maxContentLength ? 413 : 400);
+                return;
             }
+            // the first piece right away, the rest in turn with the other requests
+            size_t index = 0;
+            if (processNextChunk(request, index))
+                request->schedule([this, index](AsyncWebServerRequest* request) mutable { return processNextChunk(request, index); });
         } else {
             // No request handler defined
             request->send(500);
@@ -248,16 +288,8 @@ public:
     virtual void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override final {}
 
     virtual void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) override final {
-        if (_onRequest2) {
-            _contentLength = total;
-            if (total > 0 && _tempObject == nullptr && total < _maxContentLength) {
-                _tempObject = malloc(total);
-                _tempObjectSize = total;
-            }
-            if (_tempObject != nullptr) {
-                memcpy(static_cast<uint8_t*>(_tempObject) + index, data, len);
-            }
-        }
+        if (_onRequest2)
+            request->bufferBody(data, len, index, total, _maxContentLength);
     }
 
     virtual bool isRequestHandlerTrivial() override final { return _onRequest2 ? false : true; }
@@ -0,0 +1,457 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncJsonParser.h"
+#include <new>
+
+static bool jsonIsSpace(char c){
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int8_t jsonHex(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/*
+ * Parser
+ * */
+
+void AsyncJsonStreamParser::reset(){
+  _state = JSON_PARSE_VALUE;
+  _stringState = JSON_PARSE_STRING;
+  _fields = NULL;
+  _fieldCount = 0;
+  _base = NULL;
+  _offset = 0;
+  _depth = 0;
+  _objects = 0;
+  _pathLen[0] = 0;
+  _path[0] = 0;
+  _pathUsed = 0;
+  _pathTruncated = false;
+  _cutDepth = 0xFF;
+  _value[0] = 0;
+  _valueLen = 0;
+  _valueTruncated = false;
+  _unicode = 0;
+  _unicodeDigits = 0;
+  _surrogate = 0;
+}
+
+void AsyncJsonStreamParser::_append(char c){
+  if(_valueLen + 1 < AWS_JSON_VALUE_LENGTH)
+    _value[_valueLen++] = c;
+  else
+    _valueTruncated = true;
+}
+
+void AsyncJsonStreamParser::_appendUtf8(uint32_t cp){
+  if(cp < 0x80){
+    _append(cp);
+  } else if(cp < 0x800){
+    _append(0xC0 | (cp >> 6));
+    _append(0x80 | (cp & 0x3F));
+  } else if(cp < 0x10000){
+    _append(0xE0 | (cp >> 12));
+    _append(0x80 | ((cp >> 6) & 0x3F));
+    _append(0x80 | (cp & 0x3F));
+  } else {
+    _append(0xF0 | (cp >> 18));
+    _append(0x80 | ((cp >> 12) & 0x3F));
+    _append(0x80 | ((cp >> 6) & 0x3F));
+    _append(0x80 | (cp & 0x3F));
+  }
+}
+
+void AsyncJsonStreamParser::_pathAppend(const char * s, size_t len){
+  if(_pathUsed + len >= AWS_JSON_PATH_LENGTH){
+    len = AWS_JSON_PATH_LENGTH - 1 - _pathUsed;
+    _pathTruncated = true;
+  }
+  memcpy(_path + _pathUsed, s, len);
+  _pathUsed += len;
+  _path[_pathUsed] = 0;
+}
+
+void AsyncJsonStreamParser::_enterValue(){
+  //object members got their path from the key
+  if(_depth == 0 || (_objects & (1UL << (_depth - 1))))
+    return;
+  char index[8];
+  _pathAppend(index, snprintf(index, sizeof(index), "[%u]", (unsigned)_index[_depth - 1]));
+}
+
+void AsyncJsonStreamParser::_leaveValue(){
+  _valueLen = 0;
+  _valueTruncated = false;
+  _value[0] = 0;
+  if(_depth == 0){
+    _state = JSON_PARSE_DONE;
+    return;
+  }
+  if(!(_objects & (1UL << (_depth - 1))))
+    _index[_depth - 1]++;
+  _pathUsed = _pathLen[_depth];
+  _path[_pathUsed] = 0;
+  _pathTruncated = _cutDepth <= _depth;
+  _state = JSON_PARSE_NEXT;
+}
+
+void AsyncJsonStreamParser::_bind(const AsyncJsonEvent& event){
+  for(size_t i = 0; i < _fieldCount; i++){
+    const AsyncJsonField& f = _fields[i];
+    if(!event.is(f.path))
+      continue;
+    void * target = _base ? _base + (size_t)f.target : f.target;
+    switch(f.type){
+      case JSON_FIELD_INT:
+        if(event.type == JSON_NUMBER || event.type == JSON_BOOL)
+          *(int32_t *)target = (event.type == JSON_BOOL) ? event.toBool() : event.toInt();
+        break;
+      case JSON_FIELD_FLOAT:
+        if(event.type == JSON_NUMBER)
+          *(float *)target = event.toFloat();
+        break;
+      case JSON_FIELD_BOOL:
+        if(event.type == JSON_BOOL)
+          *(bool *)target = event.toBool();
+        else if(event.type == JSON_NUMBER)
+          *(bool *)target = event.toFloat() != 0;
+        break;
+      case JSON_FIELD_STRING:
+        if(event.type == JSON_STRING || event.type == JSON_NUMBER){
+          size_t n = std::min(event.length, f.size - 1);
+          memcpy(target, event.value, n);
+          ((char *)target)[n] = 0;
+        }
+        break;
+    }
+  }
+}
+
+void AsyncJsonStreamParser::_emit(AwsJsonEventType type, const AwsJsonEventFunction& fn){
+  if(!fn && !_fieldCount)
+    return;
+  _value[_valueLen] = 0;
+  AsyncJsonEvent event;
+  event.type = type;
+  event.path = _path;
+  event.value = _value;
+  event.length = _valueLen;
+  event.depth = _depth;
+  event.truncated = _pathTruncated || _valueTruncated;
+  if(event.isValue())
+    _bind(event);
+  if(fn)
+    fn(event);
+}
+
+bool AsyncJsonStreamParser::_open(bool object, const AwsJsonEventFunction& fn){
+  if(_depth == AWS_JSON_MAX_DEPTH)
+    return false;
+  _emit(object ? JSON_OBJECT_START : JSON_ARRAY_START, fn);
+  if(object)
+    _objects |= (1UL << _depth);
+  else
+    _objects &= ~(1UL << _depth);
+  _index[_depth] = 0;
+  _depth++;
+  _pathLen[_depth] = _pathUsed;
+  if(_pathTruncated && _cutDepth == 0xFF)
+    _cutDepth = _depth;
+  _state = object ? JSON_PARSE_KEY_OR_END : JSON_PARSE_VALUE_OR_END;
+  return true;
+}
+
+bool AsyncJsonStreamParser::_close(bool object, const AwsJsonEventFunction& fn){
+  if(_depth == 0 || !!(_objects & (1UL << (_depth - 1))) != object)
+    return false;
+  _pathUsed = _pathLen[_depth];
+  _path[_pathUsed] = 0;
+  _pathTruncated = _cutDepth <= _depth;
+  if(_cutDepth == _depth)
+    _cutDepth = 0xFF;
+  _depth--;
+  _emit(object ? JSON_OBJECT_END : JSON_ARRAY_END, fn);
+  _leaveValue();
+  return true;
+}
+
+bool AsyncJsonStreamParser::_endLiteral(const AwsJsonEventFunction& fn){
+  _value[_valueLen] = 0;
+  if(!strcmp(_value, "true") || !strcmp(_value, "false"))
+    _emit(JSON_BOOL, fn);
+  else if(!strcmp(_value, "null"))
+    _emit(JSON_NULL, fn);
+  else
+    return false;
+  _leaveValue();
+  return true;
+}
+
+bool AsyncJsonStreamParser::_step(char c, const AwsJsonEventFunction& fn){
+  switch(_state){
+    case JSON_PARSE_VALUE_OR_END:
+      if(c == ']')
+        return _close(false, fn);
+      //fall through
+    case JSON_PARSE_VALUE:
+      if(jsonIsSpace(c))
+        return true;
+      _enterValue();
+      if(c == '{')
+        return _open(true, fn);
+      if(c == '[')
+        return _open(false, fn);
+      if(c == '"'){
+        _stringState = JSON_PARSE_STRING;
+        _state = JSON_PARSE_STRING;
+        _surrogate = 0;
+        return true;
+      }
+      if(c == '-' || (c >= '0' && c <= '9')){
+        _append(c);
+        _state = JSON_PARSE_NUMBER;
+        return true;
+      }
+      if(c == 't' || c == 'f' || c == 'n'){
+        _append(c);
+        _state = JSON_PARSE_LITERAL;
+        return true;
+      }
+      return false;
+
+    case JSON_PARSE_KEY_OR_END:
+      if(c == '}')
+        return _close(true, fn);
+      //fall through
+    case JSON_PARSE_KEY:
+      if(jsonIsSpace(c))
+        return true;
+      if(c != '"')
+        return false;
+      _stringState = JSON_PARSE_KEY_STRING;
+      _state = JSON_PARSE_KEY_STRING;
+      _surrogate = 0;
+      return true;
+
+    case JSON_PARSE_KEY_STRING:
+    case JSON_PARSE_STRING:
+      if(c == '\\'){
+        _state = JSON_PARSE_ESCAPE;
+        return true;
+      }
+      if((uint8_t)c < 0x20)
+        return false;
+      if(c != '"'){
+        _append(c);
+        return true;
+      }
+      if(_state == JSON_PARSE_STRING){
+        _emit(JSON_STRING, fn);
+        _leaveValue();
+        return true;
+      }
+      //the member path is the container path and the key
+      _pathUsed = _pathLen[_depth];
+      _pathTruncated = _cutDepth <= _depth;
+      if(_pathUsed)
+        _pathAppend(".", 1);
+      _pathAppend(_value, _valueLen);
+      if(_valueTruncated)
+        _pathTruncated = true;
+      _valueLen = 0;
+      _valueTruncated = false;
+      _state = JSON_PARSE_COLON;
+      return true;
+
+    case JSON_PARSE_ESCAPE:
+      _state = _stringState;
+      switch(c){
+        case '"': case '\\': case '/': _append(c); return true;
+        case 'b': _append('\b'); return true;
+        case 'f': _append('\f'); return true;
+        case 'n': _append('\n'); return true;
+        case 'r': _append('\r'); return true;
+        case 't': _append('\t'); return true;
+        case 'u':
+          _unicode = 0;
+          _unicodeDigits = 0;
+          _state = JSON_PARSE_UNICODE;
+          return true;
+      }
+      return false;
+
+    case JSON_PARSE_UNICODE: {
+      int8_t h = jsonHex(c);
+      if(h < 0)
+        return false;
+      _unicode = (_unicode << 4) | h;
+      if(++_unicodeDigits < 4)
+        return true;
+      _state = _stringState;
+      if(_unicode >= 0xD800 && _unicode < 0xDC00){
+        //the low half follows as the next escape
+        _surrogate = _unicode;
+        return true;
+      }
+      if(_unicode >= 0xDC00 && _unicode < 0xE000){
+        if(!_surrogate){
+          _appendUtf8(0xFFFD);
+          return true;
+        }
+        _unicode = 0x10000 + ((uint32_t)(_surrogate - 0xD800) << 10) + (_unicode - 0xDC00);
+      }
+      _surrogate = 0;
+      _appendUtf8(_unicode);
+      return true;
+    }
+
+    case JSON_PARSE_COLON:
+      if(jsonIsSpace(c))
+        return true;
+      if(c != ':')
+        return false;
+      _state = JSON_PARSE_VALUE;
+      return true;
+
+    case JSON_PARSE_NUMBER:
+      if((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'){
+        _append(c);
+        return true;
+      }
+      if(!_valueTruncated){
+        _value[_valueLen] = 0;
+        char * end;
+        strtod(_value, &end);
+        if(end != _value + _valueLen)
+          return false;
+      }
+      _emit(JSON_NUMBER, fn);
+      _leaveValue();
+      //the byte that ended the number belongs to what follows
+      return _step(c, fn);
+
+    case JSON_PARSE_LITERAL:
+      if(c >= 'a' && c <= 'z' && _valueLen < 5){
+        _append(c);
+        return true;
+      }
+      if(!_endLiteral(fn))
+        return false;
+      return _step(c, fn);
+
+    case JSON_PARSE_NEXT:
+      if(jsonIsSpace(c))
+        return true;
+      if(c == ','){
+        _state = (_objects & (1UL << (_depth - 1))) ? JSON_PARSE_KEY : JSON_PARSE_VALUE;
+        return true;
+      }
+      if(c == '}' || c == ']')
+        return _close(c == '}', fn);
+      return false;
+
+    case JSON_PARSE_DONE:
+      return jsonIsSpace(c);
+
+    default:
+      return false;
+  }
+}
+
+bool AsyncJsonStreamParser::feed(const uint8_t * data, size_t len, const AwsJsonEventFunction& fn){
+  if(_state == JSON_PARSE_ERROR)
+    return false;
+  for(size_t i = 0; i < len; i++){
+    if(!_step((char)data[i], fn)){
+      _state = JSON_PARSE_ERROR;
+      return false;
+    }
+    _offset++;
+  }
+  return true;
+}
+
+bool AsyncJsonStreamParser::finish(const AwsJsonEventFunction& fn){
+  //a number or literal at the root only ends with the document
+  if(_depth == 0 && (_state == JSON_PARSE_NUMBER || _state == JSON_PARSE_LITERAL)){
+    if(!_step(' ', fn))
+      _state = JSON_PARSE_ERROR;
+  }
+  return done();
+}
+
+/*
+ * Handler
+ * */
+
+bool AsyncCallbackJsonStreamHandler::canHandle(AsyncWebServerRequest *request){
+  if(!(_method & request->method()))
+    return false;
+  if(_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/")))
+    return false;
+  return request->contentType().equalsIgnoreCase(F("application/json"));
+}
+
+void AsyncCallbackJsonStreamHandler::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+  AsyncJsonStreamParser * parser = (AsyncJsonStreamParser *)request->_tempObject;
+  if(parser == NULL){
+    if(index != 0)
+      return;
+    //the parser has no destructor, the request frees it with the rest of its state.
+    //the struct of the request follows the parser in the same block, aligned for doubles and 64 bit integers
+    const size_t head = (sizeof(AsyncJsonStreamParser) + 7) & ~(size_t)7;
+    uint8_t * mem = (uint8_t *)malloc(head + _targetSize);
+    if(mem == NULL)
+      return;
+    parser = new (mem) AsyncJsonStreamParser();
+    if(_targetSize){
+      memset(mem + head, 0, _targetSize);
+      parser->bind(_fields, _fieldCount, mem + head);
+    }
+    request->_tempObject = parser;
+    if(_onBegin)
+      _onBegin(request, *parser);
+  }
+  if(_onEvent)
+    parser->feed(data, len, [this, request](const AsyncJsonEvent& event){ _onEvent(request, event); });
+  else
+    parser->feed(data, len);
+}
+
+void AsyncCallbackJsonStreamHandler::handleRequest(AsyncWebServerRequest *request){
+  AsyncJsonStreamParser * parser = (AsyncJsonStreamParser *)request->_tempObject;
+  if(parser == NULL){
+    request->send(request->contentLength() ? 500 : 400);
+    return;
+  }
+  if(_onEvent)
+    parser->finish([this, request](const AsyncJsonEvent& event){ _onEvent(request, event); });
+  else
+    parser->finish();
+  if(_onRequest)
+    _onRequest(request, *parser);
+  else
+    request->send(parser->done() ? 200 : 400);
+}
@@ -0,0 +1,209 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCJSONPARSER_H_
+#define ASYNCJSONPARSER_H_
+
+#include <Arduino.h>
+#include <functional>
+#include <stddef.h>
+#include "ESPAsyncWebServer.h"
+
+//deepest nesting of objects and arrays, deeper documents are an error
+#ifndef AWS_JSON_MAX_DEPTH
+#define AWS_JSON_MAX_DEPTH 16
+#endif
+
+//the kind of every open container is a bit of a 32 bit mask
+static_assert(AWS_JSON_MAX_DEPTH <= 32, "AWS_JSON_MAX_DEPTH can be at most 32");
+
+//longest path ("a.b[2].c"), longer paths are cut and match no field
+#ifndef AWS_JSON_PATH_LENGTH
+#define AWS_JSON_PATH_LENGTH 96
+#endif
+
+//longest string or number delivered in one event, longer values are cut
+#ifndef AWS_JSON_VALUE_LENGTH
+#define AWS_JSON_VALUE_LENGTH 128
+#endif
+
+typedef enum {
+  JSON_OBJECT_START,
+  JSON_OBJECT_END,
+  JSON_ARRAY_START,
+  JSON_ARRAY_END,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_BOOL,
+  JSON_NULL
+} AwsJsonEventType;
+
+//one token of the document. the strings are only valid during the callback
+class AsyncJsonEvent {
+  public:
+    AwsJsonEventType type;
+    //path of the value from the root, "" for the root itself
+    const char * path;
+    //unescaped text of strings, number text as sent, "true"/"false"/"null"
+    const char * value;
+    size_t length;
+    uint8_t depth;
+    //the value or path was longer than its buffer
+    bool truncated;
+
+    bool isValue() const { return type >= JSON_STRING; }
+    long toInt() const { return atol(value); }
+    float toFloat() const { return atof(value); }
+    bool toBool() const { return type == JSON_BOOL && value[0] == 't'; }
+    bool is(const char * p) const { return !truncated && strcmp(path, p) == 0; }
+};
+
+typedef enum { JSON_FIELD_INT, JSON_FIELD_FLOAT, JSON_FIELD_BOOL, JSON_FIELD_STRING } AwsJsonFieldType;
+
+//binds the value at a path to a member of a caller provided struct
+typedef struct {
+  const char * path;
+  AwsJsonFieldType type;
+  void * target;    //address, or offset in the struct when the parser is bound with a base
+  size_t size;      //capacity of string targets including the terminator
+} AsyncJsonField;
+
+#define AWS_JSON_INT(path, ptr) { path, JSON_FIELD_INT, (void *)(int32_t *)(ptr), sizeof(int32_t) }
+#define AWS_JSON_FLOAT(path, ptr) { path, JSON_FIELD_FLOAT, (void *)(float *)(ptr), sizeof(float) }
+#define AWS_JSON_BOOL(path, ptr) { path, JSON_FIELD_BOOL, (void *)(bool *)(ptr), sizeof(bool) }
+#define AWS_JSON_STRING(path, buf) { path, JSON_FIELD_STRING, (void *)(buf), sizeof(buf) }
+
+//the same for a member of a struct that is given later, like the one every request gets from AsyncCallbackJsonStreamHandler
+#define AWS_JSON_INT_AT(path, type, member) { path, JSON_FIELD_INT, (void *)offsetof(type, member), sizeof(int32_t) }
+#define AWS_JSON_FLOAT_AT(path, type, member) { path, JSON_FIELD_FLOAT, (void *)offsetof(type, member), sizeof(float) }
+#define AWS_JSON_BOOL_AT(path, type, member) { path, JSON_FIELD_BOOL, (void *)offsetof(type, member), sizeof(bool) }
+#define AWS_JSON_STRING_AT(path, type, member) { path, JSON_FIELD_STRING, (void *)offsetof(type, member), sizeof(((type *)0)->member) }
+
+typedef std::function<void(const AsyncJsonEvent& event)> AwsJsonEventFunction;
+
+typedef enum {
+  JSON_PARSE_VALUE,       //a value is expected
+  JSON_PARSE_KEY_OR_END,  //after {
+  JSON_PARSE_VALUE_OR_END,//after [
+  JSON_PARSE_KEY,         //a key is expected after a comma
+  JSON_PARSE_KEY_STRING,
+  JSON_PARSE_COLON,
+  JSON_PARSE_STRING,
+  JSON_PARSE_ESCAPE,
+  JSON_PARSE_UNICODE,
+  JSON_PARSE_NUMBER,
+  JSON_PARSE_LITERAL,
+  JSON_PARSE_NEXT,        //, or the end of the container
+  JSON_PARSE_DONE,
+  JSON_PARSE_ERROR
+} AwsJsonParseState;
+
+//incremental JSON tokenizer. bodies are fed in pieces of any size as they arrive,
+//memory is fixed whatever the size of the document.
+//it holds no heap memory, it can be malloc()ed and free()d as it is
+class AsyncJsonStreamParser {
+  private:
+    AwsJsonParseState _state;
+    AwsJsonParseState _stringState;
+    const AsyncJsonField * _fields;
+    size_t _fieldCount;
+    uint8_t * _base;
+    size_t _offset;
+    uint8_t _depth;
+    uint32_t _objects;      //bit per depth, set for objects
+    uint16_t _index[AWS_JSON_MAX_DEPTH];
+    uint16_t _pathLen[AWS_JSON_MAX_DEPTH + 1]; //path length of each open container
+    char _path[AWS_JSON_PATH_LENGTH];
+    size_t _pathUsed;
+    bool _pathTruncated;
+    uint8_t _cutDepth;      //shallowest container whose own path was cut
+    char _value[AWS_JSON_VALUE_LENGTH];
+    size_t _valueLen;
+    bool _valueTruncated;
+    uint32_t _unicode;
+    uint8_t _unicodeDigits;
+    uint16_t _surrogate;
+
+    void _append(char c);
+    void _appendUtf8(uint32_t cp);
+    void _pathAppend(const char * s, size_t len);
+    void _enterValue();
+    void _leaveValue();
+    void _emit(AwsJsonEventType type, const AwsJsonEventFunction& fn);
+    void _bind(const AsyncJsonEvent& event);
+    bool _open(bool object, const AwsJsonEventFunction& fn);
+    bool _close(bool object, const AwsJsonEventFunction& fn);
+    bool _endLiteral(const AwsJsonEventFunction& fn);
+    bool _step(char c, const AwsJsonEventFunction& fn);
+  public:
+    AsyncJsonStreamParser(){ reset(); }
+    void reset();
+    //values at these paths are written into the targets while parsing. with a base the targets are offsets into it
+    void bind(const AsyncJsonField * fields, size_t count, void * base=NULL){ _fields = fields; _fieldCount = count; _base = (uint8_t *)base; }
+    //the base given to bind()
+    void * target() const { return _base; }
+    //feeds the next piece of the document. returns false once the document is invalid
+    bool feed(const uint8_t * data, size_t len, const AwsJsonEventFunction& fn=nullptr);
+    //true if a complete document was read
+    bool finish(const AwsJsonEventFunction& fn=nullptr);
+    bool done() const { return _state == JSON_PARSE_DONE; }
+    bool failed() const { return _state == JSON_PARSE_ERROR; }
+    //bytes consumed, on error the position of the offending byte
+    size_t offset() const { return _offset; }
+};
+
+typedef std::function<void(AsyncWebServerRequest *request, const AsyncJsonEvent& event)> ArJsonEventHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, AsyncJsonStreamParser& parser)> ArJsonStreamRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, AsyncJsonStreamParser& parser)> ArJsonStreamBeginFunction;
+
+//parses JSON bodies while they arrive. every request gets its own parser,
+//the body is never kept in memory
+class AsyncCallbackJsonStreamHandler: public AsyncWebHandler {
+  private:
+    const String _uri;
+    WebRequestMethodComposite _method;
+    ArJsonStreamBeginFunction _onBegin;
+    ArJsonEventHandlerFunction _onEvent;
+    ArJsonStreamRequestHandlerFunction _onRequest;
+    const AsyncJsonField * _fields;
+    size_t _fieldCount;
+    size_t _targetSize;
+  public:
+    AsyncCallbackJsonStreamHandler(const String& uri, ArJsonStreamRequestHandlerFunction onRequest=nullptr)
+      : _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest(onRequest), _fields(NULL), _fieldCount(0), _targetSize(0) {}
+    void setMethod(WebRequestMethodComposite method){ _method = method; }
+    //called once per request before the body is parsed, for example to set defaults in parser.target()
+    void onBegin(ArJsonStreamBeginFunction fn){ _onBegin = fn; }
+    //called for every token while the body arrives
+    void onEvent(ArJsonEventHandlerFunction fn){ _onEvent = fn; }
+    //called when the body is complete, check parser.done() before using the values
+    void onRequest(ArJsonStreamRequestHandlerFunction fn){ _onRequest = fn; }
+    //every request gets its own zeroed struct of size bytes, kept with its parser and read with parser.target().
+    //the fields are given with the _AT macros
+    void bind(const AsyncJsonField * fields, size_t count, size_t size){ _fields = fields; _fieldCount = count; _targetSize = size; }
+    template<typename T> void bind(const AsyncJsonField * fields, size_t count){ bind(fields, count, sizeof(T)); }
+
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final;
+    virtual bool isRequestHandlerTrivial() override final { return false; }
+};
+
+#endif /* ASYNCJSONPARSER_H_ */
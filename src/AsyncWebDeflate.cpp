@@ -0,0 +1,654 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Arduino.h"
+#include "AsyncWebDeflate.h"
+
+static const uint16_t DEFLATE_LENGTH_BASE[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+static const uint8_t DEFLATE_LENGTH_EXTRA[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+static const uint16_t DEFLATE_DIST_BASE[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+static const uint8_t DEFLATE_DIST_EXTRA[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+static const uint8_t DEFLATE_CLEN_ORDER[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+//the empty stored block every message ends with, stripped by the sender (RFC 7692 7.2.1)
+static const uint8_t DEFLATE_TAIL[4] = { 0x00, 0x00, 0xFF, 0xFF };
+
+/*
+ * Compressor
+ */
+
+class DeflateBitWriter {
+  private:
+    uint8_t * _out;
+    size_t _cap;
+    uint32_t _bits;
+    uint8_t _count;
+  public:
+    size_t pos;
+    bool overflow;
+    DeflateBitWriter(uint8_t * out, size_t cap):_out(out),_cap(cap),_bits(0),_count(0),pos(0),overflow(false){}
+    void put(uint32_t value, uint8_t len){
+      _bits |= value << _count;
+      _count += len;
+      while(_count >= 8){
+        if(pos < _cap)
+          _out[pos++] = _bits & 0xFF;
+        else
+          overflow = true;
+        _bits >>= 8;
+        _count -= 8;
+      }
+    }
+    //huffman codes are stored starting with their most significant bit
+    void putCode(uint32_t code, uint8_t len){
+      uint32_t rev = 0;
+      for(uint8_t i = 0; i < len; i++){
+        rev = (rev << 1) | (code & 1);
+        code >>= 1;
+      }
+      put(rev, len);
+    }
+    void flush(){
+      if(_count)
+        put(0, 8 - _count);
+    }
+};
+
+static void deflatePutSymbol(DeflateBitWriter &w, uint16_t sym){
+  if(sym < 144)
+    w.putCode(0x30 + sym, 8);
+  else if(sym < 256)
+    w.putCode(0x190 + sym - 144, 9);
+  else if(sym < 280)
+    w.putCode(sym - 256, 7);
+  else
+    w.putCode(0xC0 + sym - 280, 8);
+}
+
+static void deflatePutMatch(DeflateBitWriter &w, size_t len, size_t dist){
+  uint8_t i = 28;
+  while(DEFLATE_LENGTH_BASE[i] > len) i--;
+  deflatePutSymbol(w, 257 + i);
+  if(DEFLATE_LENGTH_EXTRA[i])
+    w.put(len - DEFLATE_LENGTH_BASE[i], DEFLATE_LENGTH_EXTRA[i]);
+  i = 29;
+  while(DEFLATE_DIST_BASE[i] > dist) i--;
+  w.putCode(i, 5);
+  if(DEFLATE_DIST_EXTRA[i])
+    w.put(dist - DEFLATE_DIST_BASE[i], DEFLATE_DIST_EXTRA[i]);
+}
+
+AsyncWebDeflater::AsyncWebDeflater(uint8_t windowBits, bool noContextTakeover)
+  :_windowBits(windowBits)
+  ,_window(NULL)
+  ,_windowLen(0)
+{
+  if(!noContextTakeover)
+    _window = (uint8_t*)malloc((size_t)1 << _windowBits);
+}
+
+AsyncWebDeflater::~AsyncWebDeflater(){
+  if(_window != NULL)
+    free(_window);
+}
+
+size_t AsyncWebDeflater::compress(const uint8_t * data, size_t len, uint8_t * out, size_t cap){
+  if(!len || !cap)
+    return 0;
+  const size_t hashSize = (size_t)1 << AWS_DEFLATE_HASH_BITS;
+  uint32_t * head = (uint32_t*)calloc(hashSize, sizeof(uint32_t));
+  if(head == NULL)
+    return 0;
+
+  //positions run over the history window followed by the new data
+  const size_t hlen = _window ? _windowLen : 0;
+  const size_t total = hlen + len;
+  const size_t maxDist = (size_t)1 << _windowBits;
+  const uint8_t * window = _window;
+  auto at = [window, hlen, data](size_t p) -> uint8_t { return (p < hlen) ? window[p] : data[p - hlen]; };
+  auto hash = [&at](size_t p) -> uint32_t {
+    uint32_t v = ((uint32_t)at(p) << 16) | ((uint32_t)at(p + 1) << 8) | at(p + 2);
+    return (uint32_t)(v * 2654435761U) >> (32 - AWS_DEFLATE_HASH_BITS);
+  };
+
+  for(size_t p = 0; p + 2 < hlen; p++)
+    head[hash(p)] = p + 1;
+
+  DeflateBitWriter w(out, cap);
+  w.put(0, 1); //BFINAL = 0, the stream continues with the next message
+  w.put(1, 2); //BTYPE = fixed huffman codes
+
+  size_t p = hlen;
+  while(p < total && !w.overflow){
+    size_t best = 0;
+    size_t dist = 0;
+    if(p + 2 < total){
+      uint32_t h = hash(p);
+      size_t candidate = head[h];
+      head[h] = p + 1;
+      if(candidate && (p - (candidate - 1)) <= maxDist){
+        candidate--;
+        size_t max = std::min((size_t)258, total - p);
+        size_t l = 0;
+        while(l < max && at(candidate + l) == at(p + l)) l++;
+        if(l >= 3){
+          best = l;
+          dist = p - candidate;
+        }
+      }
+    }
+    if(best){
+      deflatePutMatch(w, best, dist);
+      for(size_t q = p + 1; q < p + best && q + 2 < total; q++)
+        head[hash(q)] = q + 1;
+      p += best;
+    } else {
+      deflatePutSymbol(w, at(p));
+      p++;
+    }
+  }
+  free(head);
+
+  deflatePutSymbol(w, 256);
+  //empty stored block; its LEN/NLEN bytes (00 00 ff ff) are stripped from the payload
+  w.put(0, 3);
+  w.flush();
+  if(w.overflow)
+    return 0;
+
+  //the peer has seen this data now, remember it for the next message
+  if(_window){
+    const size_t size = maxDist;
+    if(len >= size){
+      memcpy(_window, data + len - size, size);
+      _windowLen = size;
+    } else {
+      size_t keep = std::min(_windowLen, size - len);
+      memmove(_window, _window + _windowLen - keep, keep);
+      memcpy(_window + keep, data, len);
+      _windowLen = keep + len;
+    }
+  }
+  return w.pos;
+}
+
+/*
+ * Decompressor
+ */
+
+typedef struct {
+  uint16_t counts[16];
+  uint16_t symbols[288];
+} DeflateHuffman;
+
+typedef struct DeflateInflateState {
+  const uint8_t * in;
+  size_t inLen;
+  size_t pos;
+  uint32_t bits;
+  uint8_t count;
+  bool error;
+  DeflateHuffman lit;
+  DeflateHuffman dist;
+  //streams read their input from a file through buffer instead of in
+  fs::File * source;
+  uint8_t buffer[64];
+} DeflateInflateState;
+
+static int inflateByte(DeflateInflateState &s){
+  if(s.source != NULL){
+    if(s.pos == s.inLen){
+      s.pos = 0;
+      s.inLen = s.source->read(s.buffer, sizeof(s.buffer));
+      if(!s.inLen){
+        s.error = true;
+        return 0;
+      }
+    }
+    return s.buffer[s.pos++];
+  }
+  if(s.pos < s.inLen)
+    return s.in[s.pos++];
+  if(s.pos < s.inLen + sizeof(DEFLATE_TAIL))
+    return DEFLATE_TAIL[s.pos++ - s.inLen];
+  s.error = true;
+  return 0;
+}
+
+static uint32_t inflateBits(DeflateInflateState &s, uint8_t need){
+  while(s.count < need){
+    s.bits |= (uint32_t)inflateByte(s) << s.count;
+    s.count += 8;
+  }
+  uint32_t v = s.bits & ((1UL << need) - 1);
+  s.bits >>= need;
+  s.count -= need;
+  return v;
+}
+
+static void inflateBuild(DeflateHuffman &h, const uint8_t * lengths, size_t n){
+  uint16_t offsets[16];
+  memset(h.counts, 0, sizeof(h.counts));
+  for(size_t i = 0; i < n; i++)
+    h.counts[lengths[i]]++;
+  h.counts[0] = 0;
+  offsets[1] = 0;
+  for(uint8_t i = 1; i < 15; i++)
+    offsets[i + 1] = offsets[i] + h.counts[i];
+  for(size_t i = 0; i < n; i++)
+    if(lengths[i])
+      h.symbols[offsets[lengths[i]]++] = i;
+}
+
+static int inflateDecode(DeflateInflateState &s, const DeflateHuffman &h){
+  int code = 0, first = 0, index = 0;
+  for(uint8_t len = 1; len < 16; len++){
+    code |= inflateBits(s, 1);
+    int count = h.counts[len];
+    if(code - count < first)
+      return h.symbols[index + (code - first)];
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  s.error = true;
+  return -1;
+}
+
+static bool inflateDynamicTables(DeflateInflateState &s){
+  uint8_t lengths[288 + 32];
+  size_t hlit = inflateBits(s, 5) + 257;
+  size_t hdist = inflateBits(s, 5) + 1;
+  size_t hclen = inflateBits(s, 4) + 4;
+  if(hlit > 286 || hdist > 30)
+    return false;
+
+  memset(lengths, 0, 19);
+  for(size_t i = 0; i < hclen; i++)
+    lengths[DEFLATE_CLEN_ORDER[i]] = inflateBits(s, 3);
+  inflateBuild(s.lit, lengths, 19);
+
+  size_t n = 0;
+  while(n < hlit + hdist && !s.error){
+    int sym = inflateDecode(s, s.lit);
+    if(sym < 16){
+      lengths[n++] = sym;
+      continue;
+    }
+    uint8_t value = 0;
+    size_t repeat;
+    if(sym == 16){
+      if(!n)
+        return false;
+      value = lengths[n - 1];
+      repeat = 3 + inflateBits(s, 2);
+    } else if(sym == 17){
+      repeat = 3 + inflateBits(s, 3);
+    } else {
+      repeat = 11 + inflateBits(s, 7);
+    }
+    if(n + repeat > hlit + hdist)
+      return false;
+    while(repeat--)
+      lengths[n++] = value;
+  }
+  if(s.error)
+    return false;
+  inflateBuild(s.lit, lengths, hlit);
+  inflateBuild(s.dist, lengths + hlit, hdist);
+  return true;
+}
+
+static void inflateFixedTables(DeflateInflateState &s){
+  uint8_t lengths[288];
+  memset(lengths, 8, 144);
+  memset(lengths + 144, 9, 112);
+  memset(lengths + 256, 7, 24);
+  memset(lengths + 280, 8, 8);
+  inflateBuild(s.lit, lengths, 288);
+  memset(lengths, 5, 30);
+  inflateBuild(s.dist, lengths, 30);
+}
+
+AsyncWebInflater::AsyncWebInflater(uint8_t windowBits, bool noContextTakeover, size_t maxLen)
+  :_windowBits(windowBits)
+  ,_window(NULL)
+  ,_windowLen(0)
+  ,_maxLen(maxLen)
+  ,_out(NULL)
+  ,_outStart(0)
+  ,_outLen(0)
+{
+  if(!noContextTakeover)
+    _window = (uint8_t*)malloc((size_t)1 << _windowBits);
+}
+
+AsyncWebInflater::~AsyncWebInflater(){
+  reset();
+  if(_window != NULL)
+    free(_window);
+}
+
+void AsyncWebInflater::reset(){
+  if(_out != NULL)
+    free(_out);
+  _out = NULL;
+  _outStart = 0;
+  _outLen = 0;
+}
+
+bool AsyncWebInflater::decompress(const uint8_t * data, size_t len){
+  reset();
+  DeflateInflateState * s = new DeflateInflateState();
+  if(s == NULL)
+    return false;
+  s->in = data;
+  s->inLen = len;
+
+  //the output starts with the history so back references can reach into previous messages
+  const size_t hlen = _window ? _windowLen : 0;
+  const size_t limit = hlen + _maxLen;
+  size_t cap = hlen + std::min(_maxLen, std::max((size_t)64, len * 4));
+  uint8_t * out = (uint8_t*)malloc(cap + 1);
+  size_t pos = hlen;
+  bool ok = (out != NULL);
+  if(ok && hlen)
+    memcpy(out, _window, hlen);
+
+  bool final = false;
+  while(ok && !final && !s->error){
+    final = inflateBits(*s, 1);
+    uint8_t type = inflateBits(*s, 2);
+    if(type == 0){
+      s->bits = 0;
+      s->count = 0;
+      size_t blen = inflateByte(*s);
+      blen |= inflateByte(*s) << 8;
+      size_t nlen = inflateByte(*s);
+      nlen |= inflateByte(*s) << 8;
+      if(s->error || (blen ^ 0xFFFF) != nlen){
+        ok = false;
+        break;
+      }
+      if(pos + blen > limit){
+        ok = false;
+        break;
+      }
+      while(pos + blen > cap){
+        cap = std::min(limit, cap * 2);
+        uint8_t * grown = (uint8_t*)realloc(out, cap + 1);
+        if(grown == NULL){ ok = false; break; }
+        out = grown;
+      }
+      while(ok && blen--)
+        out[pos++] = inflateByte(*s);
+    } else if(type == 1 || type == 2){
+      if(type == 1)
+        inflateFixedTables(*s);
+      else if(!inflateDynamicTables(*s)){
+        ok = false;
+        break;
+      }
+      while(ok && !s->error){
+        int sym = inflateDecode(*s, s->lit);
+        if(sym < 0)
+          break;
+        if(sym == 256)
+          break;
+        size_t copy = 1;
+        size_t dist = 0;
+        if(sym > 256){
+          sym -= 257;
+          if(sym >= 29){ ok = false; break; }
+          copy = DEFLATE_LENGTH_BASE[sym] + inflateBits(*s, DEFLATE_LENGTH_EXTRA[sym]);
+          int dsym = inflateDecode(*s, s->dist);
+          if(dsym < 0 || dsym >= 30){ ok = false; break; }
+          dist = DEFLATE_DIST_BASE[dsym] + inflateBits(*s, DEFLATE_DIST_EXTRA[dsym]);
+          if(dist > pos){ ok = false; break; }
+        }
+        if(pos + copy > limit){ ok = false; break; }
+        if(pos + copy > cap){
+          cap = std::min(limit, std::max(cap * 2, pos + copy));
+          uint8_t * grown = (uint8_t*)realloc(out, cap + 1);
+          if(grown == NULL){ ok = false; break; }
+          out = grown;
+        }
+        if(!dist){
+          out[pos++] = sym;
+        } else {
+          while(copy--){
+            out[pos] = out[pos - dist];
+            pos++;
+          }
+        }
+      }
+    } else {
+      ok = false;
+    }
+    //the stripped tail has been consumed, the message is complete
+    if(s->pos >= s->inLen + sizeof(DEFLATE_TAIL) && s->count < 8)
+      break;
+  }
+  ok = ok && !s->error;
+  delete s;
+
+  if(!ok){
+    if(out != NULL)
+      free(out);
+    return false;
+  }
+
+  if(_window){
+    const size_t size = (size_t)1 << _windowBits;
+    const size_t keep = std::min(pos, size);
+    memcpy(_window, out + pos - keep, keep);
+    _windowLen = keep;
+  }
+  out[pos] = 0;
+  _out = out;
+  _outStart = hlen;
+  _outLen = pos - hlen;
+  return true;
+}
+
+/*
+ * Gzip
+ */
+
+uint32_t gzipCrc32(uint32_t crc, const uint8_t * data, size_t len){
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  crc = ~crc;
+  while(len--){
+    crc ^= *data++;
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+AsyncWebGzipInflater::AsyncWebGzipInflater(fs::File * source)
+  :_source(source)
+  ,_state(NULL)
+  ,_window(NULL)
+  ,_windowSize(0)
+  ,_windowPos(0)
+  ,_size(0)
+  ,_produced(0)
+  ,_block(GZIP_BLOCK_HEADER)
+  ,_final(false)
+  ,_stored(0)
+  ,_copyLen(0)
+  ,_copyDist(0)
+{}
+
+AsyncWebGzipInflater::~AsyncWebGzipInflater(){
+  if(_state != NULL)
+    delete _state;
+  if(_window != NULL)
+    free(_window);
+}
+
+bool AsyncWebGzipInflater::begin(){
+  const size_t fileSize = _source->size();
+  if(fileSize < 18)
+    return false;
+  //the uncompressed size is the last field of the file
+  uint8_t isize[4];
+  if(!_source->seek(fileSize - 4) || _source->read(isize, 4) != 4 || !_source->seek(0))
+    return false;
+  _size = isize[0] | (isize[1] << 8) | (isize[2] << 16) | ((uint32_t)isize[3] << 24);
+
+  _state = new DeflateInflateState();
+  if(_state == NULL)
+    return false;
+  _state->source = _source;
+
+  DeflateInflateState &s = *_state;
+  uint8_t header[10];
+  for(uint8_t i = 0; i < sizeof(header); i++)
+    header[i] = inflateByte(s);
+  if(s.error || header[0] != 0x1F || header[1] != 0x8B || header[2] != 8)
+    return false;
+  const uint8_t flags = header[3];
+  if(flags & 0x04){ //FEXTRA
+    size_t xlen = inflateByte(s);
+    xlen |= inflateByte(s) << 8;
+    while(xlen-- && !s.error)
+      inflateByte(s);
+  }
+  if(flags & 0x08) //FNAME
+    while(inflateByte(s) && !s.error);
+  if(flags & 0x10) //FCOMMENT
+    while(inflateByte(s) && !s.error);
+  if(flags & 0x02){ //FHCRC
+    inflateByte(s);
+    inflateByte(s);
+  }
+  if(s.error)
+    return false;
+
+  //back references never reach further than the data produced so far
+  _windowSize = std::min((size_t)_size, (size_t)1 << 15);
+  if(_windowSize){
+    _window = (uint8_t*)malloc(_windowSize);
+    if(_window == NULL)
+      return false;
+  } else {
+    _block = GZIP_BLOCK_DONE;
+  }
+  return true;
+}
+
+bool AsyncWebGzipInflater::_nextBlock(){
+  DeflateInflateState &s = *_state;
+  if(_final){
+    _block = GZIP_BLOCK_DONE;
+    return true;
+  }
+  _final = inflateBits(s, 1);
+  uint8_t type = inflateBits(s, 2);
+  if(type == 0){
+    s.bits = 0;
+    s.count = 0;
+    size_t blen = inflateByte(s);
+    blen |= inflateByte(s) << 8;
+    size_t nlen = inflateByte(s);
+    nlen |= inflateByte(s) << 8;
+    if(s.error || (blen ^ 0xFFFF) != nlen)
+      return false;
+    _stored = blen;
+    _block = GZIP_BLOCK_STORED;
+  } else if(type == 1){
+    inflateFixedTables(s);
+    _block = GZIP_BLOCK_HUFFMAN;
+  } else if(type == 2 && inflateDynamicTables(s)){
+    _block = GZIP_BLOCK_HUFFMAN;
+  } else {
+    return false;
+  }
+  return !s.error;
+}
+
+size_t AsyncWebGzipInflater::read(uint8_t * out, size_t len){
+  if(_state == NULL || _block == GZIP_BLOCK_FAILED)
+    return 0;
+  DeflateInflateState &s = *_state;
+  size_t n = 0;
+  auto put = [&](uint8_t c){
+    _window[_windowPos] = c;
+    if(++_windowPos == _windowSize)
+      _windowPos = 0;
+    out[n++] = c;
+    _produced++;
+  };
+  while(n < len && _block != GZIP_BLOCK_DONE){
+    if(_copyLen){
+      put(_window[(_windowPos + _windowSize - _copyDist) % _windowSize]);
+      _copyLen--;
+    } else if(_block == GZIP_BLOCK_HEADER){
+      if(!_nextBlock())
+        break;
+    } else if(_block == GZIP_BLOCK_STORED){
+      if(!_stored){
+        _block = GZIP_BLOCK_HEADER;
+        continue;
+      }
+      uint8_t c = inflateByte(s);
+      if(s.error)
+        break;
+      put(c);
+      _stored--;
+    } else {
+      int sym = inflateDecode(s, s.lit);
+      if(sym < 0 || s.error)
+        break;
+      if(sym == 256){
+        _block = GZIP_BLOCK_HEADER;
+        continue;
+      }
+      if(sym < 256){
+        put(sym);
+        continue;
+      }
+      sym -= 257;
+      if(sym >= 29)
+        break;
+      size_t copy = DEFLATE_LENGTH_BASE[sym] + inflateBits(s, DEFLATE_LENGTH_EXTRA[sym]);
+      int dsym = inflateDecode(s, s.dist);
+      if(dsym < 0 || dsym >= 30)
+        break;
+      size_t dist = DEFLATE_DIST_BASE[dsym] + inflateBits(s, DEFLATE_DIST_EXTRA[dsym]);
+      if(s.error || dist > _produced || dist > _windowSize)
+        break;
+      _copyLen = copy;
+      _copyDist = dist;
+    }
+    //the trailer promised less than this
+    if(_produced > _size)
+      break;
+  }
+  if(n < len && _block != GZIP_BLOCK_DONE)
+    _block = GZIP_BLOCK_FAILED;
+  return n;
+}
@@ -0,0 +1,107 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBDEFLATE_H_
+#define ASYNCWEBDEFLATE_H_
+
+#include <Arduino.h>
+#include "FS.h"
+
+//size of the match finder hash table (entries = 1 << bits), allocated only while compressing
+#ifndef AWS_DEFLATE_HASH_BITS
+#define AWS_DEFLATE_HASH_BITS 10
+#endif
+
+//raw DEFLATE compressor (LZ77 + fixed Huffman codes). every call ends with an empty stored block
+//without its LEN/NLEN bytes, the form of RFC 7692 message payloads
+class AsyncWebDeflater {
+  private:
+    uint8_t _windowBits;
+    uint8_t * _window;
+    size_t _windowLen;
+  public:
+    AsyncWebDeflater(uint8_t windowBits, bool noContextTakeover);
+    ~AsyncWebDeflater();
+    uint8_t windowBits() const { return _windowBits; }
+    bool contextTakeover() const { return _window != NULL; }
+    //compresses len bytes into out. returns the compressed length, or 0 if the result
+    //would not fit in cap bytes (the message should then be sent uncompressed)
+    size_t compress(const uint8_t * data, size_t len, uint8_t * out, size_t cap);
+};
+
+//raw DEFLATE decompressor for complete payloads in the form the deflater writes
+class AsyncWebInflater {
+  private:
+    uint8_t _windowBits;
+    uint8_t * _window;
+    size_t _windowLen;
+    size_t _maxLen;
+    uint8_t * _out;
+    size_t _outStart;
+    size_t _outLen;
+  public:
+    AsyncWebInflater(uint8_t windowBits, bool noContextTakeover, size_t maxLen);
+    ~AsyncWebInflater();
+    //inflates one message. the result stays valid until reset() or the next call
+    bool decompress(const uint8_t * data, size_t len);
+    uint8_t * data(){ return _out ? _out + _outStart : NULL; }
+    size_t length() const { return _outLen; }
+    void reset();
+};
+
+//crc of the gzip trailer, start with 0 and feed the data in any pieces
+uint32_t gzipCrc32(uint32_t crc, const uint8_t * data, size_t len);
+
+struct DeflateInflateState;
+
+typedef enum { GZIP_BLOCK_HEADER, GZIP_BLOCK_STORED, GZIP_BLOCK_HUFFMAN, GZIP_BLOCK_DONE, GZIP_BLOCK_FAILED } AwsGzipBlock;
+
+//streaming decompressor for .gz files. the file is read as the output is asked for,
+//the history window is the uncompressed size from the trailer, at most 32KB
+class AsyncWebGzipInflater {
+  private:
+    fs::File * _source;
+    DeflateInflateState * _state;
+    uint8_t * _window;
+    size_t _windowSize;
+    size_t _windowPos;
+    uint32_t _size;
+    uint32_t _produced;
+    AwsGzipBlock _block;
+    bool _final;
+    size_t _stored;
+    size_t _copyLen;
+    size_t _copyDist;
+    bool _nextBlock();
+  public:
+    //the file has to stay open while the inflater is used
+    AsyncWebGzipInflater(fs::File * source);
+    ~AsyncWebGzipInflater();
+    //reads the gzip header and allocates the window. false if the file is not usable
+    bool begin();
+    //uncompressed size from the trailer
+    uint32_t size() const { return _size; }
+    bool finished() const { return _block == GZIP_BLOCK_DONE; }
+    bool failed() const { return _block == GZIP_BLOCK_FAILED; }
+    //returns less than len only at the end of the data or on a corrupt stream
+    size_t read(uint8_t * out, size_t len);
+};
+
+#endif /* ASYNCWEBDEFLATE_H_ */
@@ -0,0 +1,295 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebResponseImpl.h"
+
+//microseconds
+static const uint32_t parseTimeBuckets[] = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+static const uint32_t handlerTimeBuckets[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+
+//printf of newlib-nano has no %llu
+static const char * metricsU64(char * out, uint64_t value){
+  char * p = out + 20;
+  *p = 0;
+  do {
+    *--p = '0' + (value % 10);
+    value /= 10;
+  } while(value);
+  return p;
+}
+
+static size_t metricsLine(char * buf, size_t cap, int len){
+  if(len < 0)
+    return 0;
+  return ((size_t)len < cap) ? (size_t)len : cap - 1;
+}
+
+/*
+ * Metrics
+ * */
+
+size_t AsyncWebCounter::_format(size_t step, char * buf, size_t cap, bool json){
+  if(step)
+    return 0;
+  char num[21];
+  if(json)
+    return metricsLine(buf, cap, snprintf(buf, cap, "\"%s\":%s", name(), metricsU64(num, value())));
+  return metricsLine(buf, cap, snprintf(buf, cap, "%s %s\n", name(), metricsU64(num, value())));
+}
+
+size_t AsyncWebGauge::_format(size_t step, char * buf, size_t cap, bool json){
+  if(step)
+    return 0;
+  if(json)
+    return metricsLine(buf, cap, snprintf(buf, cap, "\"%s\":%ld", name(), (long)value()));
+  return metricsLine(buf, cap, snprintf(buf, cap, "%s %ld\n", name(), (long)value()));
+}
+
+AsyncWebHistogram::AsyncWebHistogram(const char * name, const char * help, const uint32_t * bounds, uint8_t buckets)
+  : AsyncWebMetric(name, help)
+  , _bounds(bounds)
+  , _buckets(buckets > AWS_METRICS_MAX_BUCKETS ? AWS_METRICS_MAX_BUCKETS : buckets)
+  , _count(0)
+  , _sum(0)
+{
+  memset(_counts, 0, sizeof(_counts));
+}
+
+void AsyncWebHistogram::observe(uint32_t value){
+  _count++;
+  _sum += value;
+  for(uint8_t i = 0; i < _buckets; i++){
+    if(value <= _bounds[i]){
+      _counts[i]++;
+      return;
+    }
+  }
+}
+
+uint32_t AsyncWebHistogram::_cumulative(size_t bucket) const {
+  uint32_t total = 0;
+  for(size_t i = 0; i <= bucket; i++)
+    total += _counts[i];
+  return total;
+}
+
+uint32_t AsyncWebHistogram::percentile(uint8_t p) const {
+  uint32_t rank = ((uint64_t)_count * p + 99) / 100;
+  uint32_t total = 0;
+  for(uint8_t i = 0; i < _buckets; i++){
+    total += _counts[i];
+    if(total >= rank)
+      return _bounds[i];
+  }
+  return 0xFFFFFFFF;
+}
+
+size_t AsyncWebHistogram::_format(size_t step, char * buf, size_t cap, bool json){
+  char num[21];
+  if(json){
+    //"name":{"count":n,"sum":s,"buckets":{"100":a,"250":b,"+Inf":n}}
+    if(step == 0)
+      return metricsLine(buf, cap, snprintf(buf, cap, "\"%s\":{\"count\":%u,\"sum\":%s,\"buckets\":{", name(), (unsigned)_count, metricsU64(num, _sum)));
+    if(step <= _buckets)
+      return metricsLine(buf, cap, snprintf(buf, cap, "\"%u\":%u,", (unsigned)_bounds[step - 1], (unsigned)_cumulative(step - 1)));
+    if(step == (size_t)_buckets + 1)
+      return metricsLine(buf, cap, snprintf(buf, cap, "\"+Inf\":%u}}", (unsigned)_count));
+    return 0;
+  }
+  if(step < _buckets)
+    return metricsLine(buf, cap, snprintf(buf, cap, "%s_bucket{le=\"%u\"} %u\n", name(), (unsigned)_bounds[step], (unsigned)_cumulative(step)));
+  if(step == _buckets)
+    return metricsLine(buf, cap, snprintf(buf, cap, "%s_bucket{le=\"+Inf\"} %u\n", name(), (unsigned)_count));
+  if(step == (size_t)_buckets + 1)
+    return metricsLine(buf, cap, snprintf(buf, cap, "%s_sum %s\n", name(), metricsU64(num, _sum)));
+  if(step == (size_t)_buckets + 2)
+    return metricsLine(buf, cap, snprintf(buf, cap, "%s_count %u\n", name(), (unsigned)_count));
+  return 0;
+}
+
+/*
+ * Registry
+ * */
+
+AsyncWebMetrics::AsyncWebMetrics()
+  : _head(NULL)
+  , _tail(NULL)
+  , httpConnections("http_connections_total", "Accepted TCP connections")
+  , httpRejected("http_connections_rejected_total", "Connections closed for lack of memory")
+  , httpRequests("http_requests_total", "Requests dispatched to a handler")
+  , httpBytesReceived("http_received_bytes_total", "Request bytes received")
+  , httpBytesSent("http_sent_bytes_total", "Response bytes acknowledged by clients")
+  , httpParseTime("http_request_parse_microseconds", "First request byte to end of headers", parseTimeBuckets, sizeof(parseTimeBuckets) / sizeof(parseTimeBuckets[0]))
+  , httpHandlerTime("http_handler_microseconds", "Time spent in handleRequest", handlerTimeBuckets, sizeof(handlerTimeBuckets) / sizeof(handlerTimeBuckets[0]))
+  , wsClients("ws_clients", "Connected websocket clients")
+  , wsQueuedBytes("ws_queued_bytes", "Bytes waiting in websocket send queues")
+  , wsDropped("ws_dropped_messages_total", "Websocket messages dropped by queue limits")
+  , sseClients("sse_clients", "Connected event source clients")
+  , sseQueuedBytes("sse_queued_bytes", "Bytes waiting in event source queues")
+  , sseDropped("sse_dropped_events_total", "Events dropped or coalesced by queue limits")
+  , schedulerJobs("scheduler_jobs", "Jobs waiting for their next step")
+  , schedulerSteps("scheduler_steps_total", "Job steps run")
+  , schedulerCancelled("scheduler_cancelled_jobs_total", "Jobs dropped because their request disconnected")
+  , schedulerStepTime("scheduler_step_microseconds", "Time spent in one job step", handlerTimeBuckets, sizeof(handlerTimeBuckets) / sizeof(handlerTimeBuckets[0]))
+#ifdef ASYNCWEBSERVER_HOST
+  , freeHeap("heap_free_bytes", "Free heap")
+#else
+  , freeHeap("heap_free_bytes", "Free heap", [](){ return (int32_t)ESP.getFreeHeap(); })
+#endif
+{
+  add(&httpConnections);
+  add(&httpRejected);
+  add(&httpRequests);
+  add(&httpBytesReceived);
+  add(&httpBytesSent);
+  add(&httpParseTime);
+  add(&httpHandlerTime);
+  add(&wsClients);
+  add(&wsQueuedBytes);
+  add(&wsDropped);
+  add(&sseClients);
+  add(&sseQueuedBytes);
+  add(&sseDropped);
+  add(&schedulerJobs);
+  add(&schedulerSteps);
+  add(&schedulerCancelled);
+  add(&schedulerStepTime);
+#ifndef ASYNCWEBSERVER_HOST
+  //a host has no free heap figure to sample, the gauge would always read 0
+  add(&freeHeap);
+#endif
+}
+
+void AsyncWebMetrics::add(AsyncWebMetric * metric){
+  if(metric == NULL || metric->_next != NULL || metric == _tail)
+    return;
+  if(_tail == NULL)
+    _head = metric;
+  else
+    _tail->_next = metric;
+  _tail = metric;
+}
+
+bool AsyncWebMetrics::remove(AsyncWebMetric * metric){
+  AsyncWebMetric * prev = NULL;
+  for(AsyncWebMetric * m = _head; m != NULL; prev = m, m = m->_next){
+    if(m != metric)
+      continue;
+    if(prev == NULL)
+      _head = m->_next;
+    else
+      prev->_next = m->_next;
+    if(_tail == m)
+      _tail = prev;
+    m->_next = NULL;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Response
+ * */
+
+AsyncWebMetricsResponse::AsyncWebMetricsResponse(bool json)
+  : _json(json)
+  , _metric(AsyncWebMetrics::Instance().first())
+  , _step(0)
+  , _lineLen(0)
+  , _linePos(0)
+{
+  _code = 200;
+  _contentType = json ? F("application/json") : F("text/plain; version=0.0.4");
+  _sendContentLength = false;
+  _chunked = true;
+  if(_json){
+    _line[0] = '{';
+    _line[1] = '}';
+    _lineLen = (_metric == NULL) ? 2 : 1;
+  }
+}
+
+bool AsyncWebMetricsResponse::_nextLine(){
+  _linePos = 0;
+  _lineLen = 0;
+  while(_metric != NULL){
+    size_t step = _step++;
+    if(_json){
+      //metrics after the first one are separated by a comma
+      size_t sep = (step == 0 && _metric != AsyncWebMetrics::Instance().first()) ? 1 : 0;
+      if(sep)
+        _line[0] = ',';
+      _lineLen = _metric->_format(step, _line + sep, sizeof(_line) - sep, true);
+      if(_lineLen){
+        _lineLen += sep;
+        return true;
+      }
+    } else if(step == 0){
+      _lineLen = metricsLine(_line, sizeof(_line), snprintf(_line, sizeof(_line), "# HELP %s %s\n", _metric->name(), _metric->help()));
+      return true;
+    } else if(step == 1){
+      _lineLen = metricsLine(_line, sizeof(_line), snprintf(_line, sizeof(_line), "# TYPE %s %s\n", _metric->name(), _metric->type()));
+      return true;
+    } else {
+      _lineLen = _metric->_format(step - 2, _line, sizeof(_line), false);
+      if(_lineLen)
+        return true;
+    }
+    _metric = _metric->_next;
+    _step = 0;
+    if(_metric == NULL && _json){
+      _line[0] = '}';
+      _lineLen = 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t AsyncWebMetricsResponse::_fillBuffer(uint8_t *data, size_t len){
+  size_t written = 0;
+  while(written < len){
+    if(_linePos == _lineLen && !_nextLine())
+      break;
+    size_t n = _lineLen - _linePos;
+    if(n > len - written)
+      n = len - written;
+    memcpy(data + written, _line + _linePos, n);
+    _linePos += n;
+    written += n;
+  }
+  return written;
+}
+
+/*
+ * Handler
+ * */
+
+bool AsyncWebMetricsHandler::canHandle(AsyncWebServerRequest *request){
+  return request->method() == HTTP_GET && request->url() == _url;
+}
+
+void AsyncWebMetricsHandler::handleRequest(AsyncWebServerRequest *request){
+  if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
+    return request->requestAuthentication();
+  bool json = request->hasParam("format") && request->getParam("format")->value() == "json";
+  request->send(new AsyncWebMetricsResponse(json));
+}
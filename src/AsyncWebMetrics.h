@@ -0,0 +1,169 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBMETRICS_H_
+#define ASYNCWEBMETRICS_H_
+
+#include <Arduino.h>
+#include <functional>
+
+//set to 0 to compile the instrumentation of the server out
+#ifndef ASYNCWEBSERVER_METRICS
+#define ASYNCWEBSERVER_METRICS 1
+#endif
+
+//most buckets a histogram can have (+Inf is implicit)
+#ifndef AWS_METRICS_MAX_BUCKETS
+#define AWS_METRICS_MAX_BUCKETS 12
+#endif
+
+//longest line of the exposition, longer lines are cut
+#define AWS_METRICS_LINE_LENGTH 128
+
+#if ASYNCWEBSERVER_METRICS
+#define AWS_METRIC(expr) AsyncWebMetrics::Instance().expr
+#else
+#define AWS_METRIC(expr)
+#endif
+
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+#include <atomic>
+//counters and gauges are updated from the network task and from application tasks at once
+typedef std::atomic<uint64_t> AwsCounterValue;
+typedef std::atomic<int32_t> AwsGaugeValue;
+#else
+typedef uint64_t AwsCounterValue;
+typedef int32_t AwsGaugeValue;
+#endif
+
+class AsyncWebMetrics;
+class AsyncWebMetricsResponse;
+
+typedef std::function<int32_t(void)> AwsGaugeFunction;
+
+class AsyncWebMetric {
+  friend class AsyncWebMetrics;
+  friend class AsyncWebMetricsResponse;
+  private:
+    const char * _name;
+    const char * _help;
+    AsyncWebMetric * _next;
+  public:
+    AsyncWebMetric(const char * name, const char * help): _name(name), _help(help), _next(NULL) {}
+    virtual ~AsyncWebMetric(){}
+    const char * name() const { return _name; }
+    const char * help() const { return _help; }
+    virtual const char * type() const = 0;
+    //writes line number step of the value lines into buf. returns the length, 0 after the last line
+    virtual size_t _format(size_t step, char * buf, size_t cap, bool json) = 0;
+};
+
+class AsyncWebCounter: public AsyncWebMetric {
+  private:
+    AwsCounterValue _value;
+  public:
+    AsyncWebCounter(const char * name, const char * help): AsyncWebMetric(name, help), _value(0) {}
+    void inc(uint32_t n=1){ _value += n; }
+    uint64_t value() const { return _value; }
+    const char * type() const override { return "counter"; }
+    size_t _format(size_t step, char * buf, size_t cap, bool json) override;
+};
+
+class AsyncWebGauge: public AsyncWebMetric {
+  private:
+    AwsGaugeValue _value;
+    AwsGaugeFunction _sample;
+  public:
+    AsyncWebGauge(const char * name, const char * help): AsyncWebMetric(name, help), _value(0), _sample(NULL) {}
+    //the value is read from the function whenever the metrics are served
+    AsyncWebGauge(const char * name, const char * help, AwsGaugeFunction sample): AsyncWebMetric(name, help), _value(0), _sample(sample) {}
+    void set(int32_t value){ _value = value; }
+    void add(int32_t delta){ _value += delta; }
+    void inc(){ _value++; }
+    void dec(){ _value--; }
+    int32_t value() const { return _sample ? _sample() : (int32_t)_value; }
+    const char * type() const override { return "gauge"; }
+    size_t _format(size_t step, char * buf, size_t cap, bool json) override;
+};
+
+//fixed buckets, bounds must be ascending and outlive the histogram
+class AsyncWebHistogram: public AsyncWebMetric {
+  private:
+    const uint32_t * _bounds;
+    uint8_t _buckets;
+    uint32_t _counts[AWS_METRICS_MAX_BUCKETS];
+    uint32_t _count;
+    uint64_t _sum;
+    uint32_t _cumulative(size_t bucket) const;
+  public:
+    AsyncWebHistogram(const char * name, const char * help, const uint32_t * bounds, uint8_t buckets);
+    void observe(uint32_t value);
+    uint32_t count() const { return _count; }
+    uint64_t sum() const { return _sum; }
+    //upper bound of the bucket holding the percentile, 0xFFFFFFFF if it is past the last bound
+    uint32_t percentile(uint8_t p) const;
+    const char * type() const override { return "histogram"; }
+    size_t _format(size_t step, char * buf, size_t cap, bool json) override;
+};
+
+//registry of every exported metric, including the ones of the server itself
+class AsyncWebMetrics {
+  private:
+    AsyncWebMetric * _head;
+    AsyncWebMetric * _tail;
+    AsyncWebMetrics();
+  public:
+    //connections and requests
+    AsyncWebCounter httpConnections;
+    AsyncWebCounter httpRejected;
+    AsyncWebCounter httpRequests;
+    AsyncWebCounter httpBytesReceived;
+    AsyncWebCounter httpBytesSent;
+    AsyncWebHistogram httpParseTime;
+    AsyncWebHistogram httpHandlerTime;
+    //websocket
+    AsyncWebGauge wsClients;
+    AsyncWebGauge wsQueuedBytes;
+    AsyncWebCounter wsDropped;
+    //event source
+    AsyncWebGauge sseClients;
+    AsyncWebGauge sseQueuedBytes;
+    AsyncWebCounter sseDropped;
+    //cooperative jobs
+    AsyncWebGauge schedulerJobs;
+    AsyncWebCounter schedulerSteps;
+    AsyncWebCounter schedulerCancelled;
+    AsyncWebHistogram schedulerStepTime;
+    AsyncWebGauge freeHeap;
+
+    //metrics are not copied, they have to stay alive while they are registered
+    void add(AsyncWebMetric * metric);
+    bool remove(AsyncWebMetric * metric);
+    AsyncWebMetric * first() const { return _head; }
+
+    AsyncWebMetrics(AsyncWebMetrics const &) = delete;
+    AsyncWebMetrics &operator=(AsyncWebMetrics const &) = delete;
+    static AsyncWebMetrics &Instance() {
+      static AsyncWebMetrics instance;
+      return instance;
+    }
+};
+
+#endif /* ASYNCWEBMETRICS_H_ */
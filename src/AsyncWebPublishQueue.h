@@ -0,0 +1,131 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBPUBLISHQUEUE_H_
+#define ASYNCWEBPUBLISHQUEUE_H_
+
+#include <Arduino.h>
+#include <utility>
+
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+#define AWS_ATOMIC_LOAD(p, order) __atomic_load_n(p, order)
+#define AWS_ATOMIC_STORE(p, v, order) __atomic_store_n(p, v, order)
+#define AWS_ATOMIC_CAS(p, expected, desired) __atomic_compare_exchange_n(p, expected, desired, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#else
+//ESP8266 has a single context, producers and the network stack never interleave
+#define AWS_ATOMIC_LOAD(p, order) (*(p))
+#define AWS_ATOMIC_STORE(p, v, order) (*(p) = (v))
+#define AWS_ATOMIC_CAS(p, expected, desired) ((*(p) == *(expected)) ? ((*(p) = (desired)), true) : ((*(expected) = *(p)), false))
+#endif
+
+//bounded lock-free multi producer / single consumer ring.
+//application tasks push from any core, the network task pops.
+//every cell carries a sequence number telling whose turn it is (D. Vyukov's bounded queue)
+template <typename T>
+class AsyncWebPublishQueue {
+  private:
+    typedef struct {
+      uint32_t seq;
+      T data;
+    } Cell;
+    Cell * _cells;
+    uint32_t _mask;
+    uint32_t _head;
+    uint32_t _tail;
+    uint32_t _rejected;
+
+  public:
+    //capacity is rounded up to a power of two
+    AsyncWebPublishQueue(size_t capacity)
+      : _cells(NULL)
+      , _mask(0)
+      , _head(0)
+      , _tail(0)
+      , _rejected(0)
+    {
+      size_t size = 2;
+      while(size < capacity)
+        size <<= 1;
+      _cells = new Cell[size];
+      if(_cells == NULL)
+        return;
+      _mask = size - 1;
+      for(size_t i = 0; i < size; i++)
+        _cells[i].seq = i;
+    }
+    ~AsyncWebPublishQueue(){
+      if(_cells != NULL)
+        delete[] _cells;
+    }
+
+    size_t capacity() const { return _cells ? _mask + 1 : 0; }
+    //approximate number of queued entries
+    size_t length() const { return AWS_ATOMIC_LOAD(&_tail, __ATOMIC_RELAXED) - AWS_ATOMIC_LOAD(&_head, __ATOMIC_RELAXED); }
+    bool isEmpty() const { return length() == 0; }
+    //pushes that failed because the ring was full
+    uint32_t rejected() const { return _rejected; }
+
+    //any task. returns false without waiting if the ring is full
+    bool push(const T &value){
+      if(_cells == NULL)
+        return false;
+      uint32_t pos = AWS_ATOMIC_LOAD(&_tail, __ATOMIC_RELAXED);
+      Cell * cell;
+      for(;;){
+        cell = &_cells[pos & _mask];
+        uint32_t seq = AWS_ATOMIC_LOAD(&cell->seq, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+        if(diff == 0){
+          if(AWS_ATOMIC_CAS(&_tail, &pos, pos + 1))
+            break;
+        } else if(diff < 0){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+          __atomic_add_fetch(&_rejected, 1, __ATOMIC_RELAXED);
+#else
+          _rejected++;
+#endif
+          return false;
+        } else {
+          pos = AWS_ATOMIC_LOAD(&_tail, __ATOMIC_RELAXED);
+        }
+      }
+      cell->data = value;
+      AWS_ATOMIC_STORE(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    //network task only
+    bool pop(T &value){
+      if(_cells == NULL)
+        return false;
+      uint32_t pos = _head;
+      Cell * cell = &_cells[pos & _mask];
+      uint32_t seq = AWS_ATOMIC_LOAD(&cell->seq, __ATOMIC_ACQUIRE);
+      if((int32_t)(seq - (pos + 1)) < 0)
+        return false;
+      value = std::move(cell->data);
+      cell->data = T();
+      AWS_ATOMIC_STORE(&_head, pos + 1, __ATOMIC_RELAXED);
+      AWS_ATOMIC_STORE(&cell->seq, pos + _mask + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+};
+
+#endif /* ASYNCWEBPUBLISHQUEUE_H_ */
@@ -0,0 +1,128 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+
+AsyncWebScheduler::AsyncWebScheduler()
+  : _head(NULL)
+  , _tail(NULL)
+  , _current(NULL)
+  , _currentCancelled(false)
+  , _budget(AWS_SCHEDULER_BUDGET_US)
+  , _jobs(0)
+  , _steps(0)
+{}
+
+AsyncWebScheduler::~AsyncWebScheduler(){
+  while(_head != NULL){
+    AsyncWebJob * job = _head;
+    _head = job->next;
+    _finish(job);
+  }
+  _tail = NULL;
+}
+
+void AsyncWebScheduler::_push(AsyncWebJob * job){
+  job->next = NULL;
+  if(_tail == NULL)
+    _head = job;
+  else
+    _tail->next = job;
+  _tail = job;
+}
+
+void AsyncWebScheduler::_finish(AsyncWebJob * job){
+  _jobs--;
+  AWS_METRIC(schedulerJobs.dec());
+  delete job;
+}
+
+bool AsyncWebScheduler::add(AsyncWebServerRequest * request, AwsJobFunction step){
+  if(!step)
+    return false;
+  AsyncWebJob * job = new AsyncWebJob();
+  if(job == NULL)
+    return false;
+  job->request = request;
+  job->step = step;
+  _push(job);
+  _jobs++;
+  AWS_METRIC(schedulerJobs.inc());
+  return true;
+}
+
+size_t AsyncWebScheduler::cancel(AsyncWebServerRequest * request){
+  size_t dropped = 0;
+  if(_current != NULL && _current->request == request && !_currentCancelled){
+    //run() drops it when the step returns
+    _currentCancelled = true;
+    dropped++;
+  }
+  AsyncWebJob * prev = NULL;
+  AsyncWebJob * job = _head;
+  while(job != NULL){
+    AsyncWebJob * next = job->next;
+    if(job->request != request){
+      prev = job;
+      job = next;
+      continue;
+    }
+    if(prev == NULL)
+      _head = next;
+    else
+      prev->next = next;
+    if(_tail == job)
+      _tail = prev;
+    _finish(job);
+    dropped++;
+    job = next;
+  }
+  AWS_METRIC(schedulerCancelled.inc(dropped));
+  return dropped;
+}
+
+void AsyncWebScheduler::run(){
+  //a step that causes network events must not run the others from inside itself
+  if(_current != NULL)
+    return;
+  uint32_t start = micros();
+  while(_head != NULL){
+    AsyncWebJob * job = _head;
+    _head = job->next;
+    if(_head == NULL)
+      _tail = NULL;
+    _current = job;
+    _currentCancelled = false;
+    uint32_t stepStart = micros();
+    bool more = job->step(job->request);
+    uint32_t now = micros();
+    _current = NULL;
+    _steps++;
+    AWS_METRIC(schedulerSteps.inc());
+    AWS_METRIC(schedulerStepTime.observe(now - stepStart));
+    //the job goes behind the others, every job gets a step before any gets a second one
+    if(more && !_currentCancelled)
+      _push(job);
+    else
+      _finish(job);
+    if(now - start >= _budget)
+      break;
+  }
+}
@@ -0,0 +1,77 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSCHEDULER_H_
+#define ASYNCWEBSCHEDULER_H_
+
+#include <Arduino.h>
+#include <functional>
+
+//time one tick of the scheduler may spend running jobs, in microseconds
+#ifndef AWS_SCHEDULER_BUDGET_US
+#define AWS_SCHEDULER_BUDGET_US 2000
+#endif
+
+class AsyncWebServerRequest;
+
+//one step of a job, keep it short. returns true while there is more to do
+typedef std::function<bool(AsyncWebServerRequest *request)> AwsJobFunction;
+
+typedef struct AsyncWebJob {
+  struct AsyncWebJob * next;
+  AsyncWebServerRequest * request;
+  AwsJobFunction step;
+} AsyncWebJob;
+
+//runs long work of handlers in small steps between network events, so that no request
+//holds the network task for long. jobs take turns, one step each, until the budget of the tick is spent.
+//everything runs on the network task, jobs are added from handlers or other network callbacks
+class AsyncWebScheduler {
+  private:
+    AsyncWebJob * _head;
+    AsyncWebJob * _tail;
+    AsyncWebJob * _current;
+    bool _currentCancelled;
+    uint32_t _budget;
+    size_t _jobs;
+    uint32_t _steps;
+
+    void _push(AsyncWebJob * job);
+    void _finish(AsyncWebJob * job);
+  public:
+    AsyncWebScheduler();
+    ~AsyncWebScheduler();
+
+    //queues a job behind the others. request is NULL for jobs that belong to no request
+    bool add(AsyncWebServerRequest * request, AwsJobFunction step);
+    //drops the jobs of the request, a step that is running is not interrupted. returns the number dropped
+    size_t cancel(AsyncWebServerRequest * request);
+    //runs steps until every job is done or the budget is spent
+    void run();
+
+    void setBudget(uint32_t us){ _budget = us; }
+    uint32_t budget() const { return _budget; }
+    //jobs waiting or running
+    size_t jobs() const { return _jobs; }
+    //steps run since the start
+    uint32_t steps() const { return _steps; }
+};
+
+#endif /* ASYNCWEBSCHEDULER_H_ */
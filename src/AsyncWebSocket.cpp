@@ -42,6 +42,9 @@ void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
 
 #define MAX_PRINTF_LEN 64
 
+//RSV1 marks the first frame of a permessage-deflate compressed message
+#define WS_RSV1_COMPRESSED 0x40
+
 size_t webSocketSendFrameWindow(AsyncClient *client){
   if(!client->canSend())
     return 0;
@@ -74,13 +77,8 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
 
   if(len > space) len = space;
 
-  uint8_t *buf = (uint8_t*)malloc(headLen);
-  if(buf == NULL){
-    //os_printf("could not malloc %u bytes for frame header\n", headLen);
-    return 0;
-  }
-
-  buf[0] = opcode & 0x0F;
+  uint8_t buf[8];
+  buf[0] = opcode & (0x0F | WS_RSV1_COMPRESSED);
   if(final)
     buf[0] |= 0x80;
   if(len < 126)
@@ -96,10 +94,8 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
   }
   if(client->add((const char *)buf, headLen) != headLen){
     //os_printf("error adding %lu header bytes\n", headLen);
-    free(buf);
     return 0;
   }
-  free(buf);
 
   if(len){
     if(len && mask){
@@ -279,6 +275,57 @@ class AsyncWebSocketControl {
     }
 };
 
+/*
+ * Message formatting helpers
+ */
+
+static int webSocketFormat(bool progmem, char * dest, size_t size, const char * format, va_list arg){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  (void)progmem;
+  return vsnprintf(dest, size, format, arg);
+#else
+  if(progmem)
+    return vsnprintf_P(dest, size, format, arg);
+  return vsnprintf(dest, size, format, arg);
+#endif
+}
+
+//formats straight into the payload of a new message. short output is measured on the stack
+//and copied, longer output is formatted a second time into the payload itself
+static AsyncWebSocketBasicMessage * webSocketFormatMessage(bool progmem, const char * format, va_list arg){
+  char temp[MAX_PRINTF_LEN];
+  va_list copy;
+  va_copy(copy, arg);
+  int len = webSocketFormat(progmem, temp, MAX_PRINTF_LEN, format, copy);
+  va_end(copy);
+  if(len < 0)
+    return NULL;
+  AsyncWebSocketBasicMessage * m = new AsyncWebSocketBasicMessage(WS_TEXT);
+  if(m == NULL)
+    return NULL;
+  if(!m->reserve(len)){
+    delete m;
+    return NULL;
+  }
+  if(len < MAX_PRINTF_LEN)
+    memcpy(m->data(), temp, len);
+  else
+    webSocketFormat(progmem, (char *)m->data(), len + 1, format, arg);
+  return m;
+}
+
+static AsyncWebSocketBasicMessage * webSocketFlashMessage(PGM_P data, size_t len, uint8_t opcode){
+  AsyncWebSocketBasicMessage * m = new AsyncWebSocketBasicMessage(opcode);
+  if(m == NULL)
+    return NULL;
+  if(!m->reserve(len)){
+    delete m;
+    return NULL;
+  }
+  memcpy_P(m->data(), data, len);
+  return m;
+}
+
 /*
  * Basic Buffered Message
  */
@@ -315,11 +362,41 @@ AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(uint8_t opcode, bool mask
 }
 
 
+AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(String && data, uint8_t opcode, bool mask)
+  :_len(data.length())
+  ,_sent(0)
+  ,_ack(0)
+  ,_acked(0)
+  ,_data(NULL)
+  ,_string(std::move(data))
+{
+  _opcode = opcode & 0x07;
+  _mask = mask;
+  _status = WS_MSG_SENDING;
+  if(_len)
+    _data = (uint8_t*)_string.begin();
+}
+
+
 AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
-  if(_data != NULL)
+  if(_data != NULL && !_string.length())
     free(_data);
 }
 
+bool AsyncWebSocketBasicMessage::reserve(size_t size) { 
+  if(_data != NULL)
+    return false;
+  _data = (uint8_t*)malloc(size + 1);
+  if(_data == NULL){
+    _status = WS_MSG_ERROR;
+    return false;
+  }
+  _data[size] = 0;
+  _len = size;
+  _status = WS_MSG_SENDING;
+  return true;
+}
+
  void AsyncWebSocketBasicMessage::ack(size_t len, uint32_t time)  {
   _acked += len;
   if(_sent == _len && _acked == _ack){
@@ -355,6 +432,8 @@ AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
   bool final = (_sent == _len);
   uint8_t* dPtr = (uint8_t*)(_data + (_sent - toSend));
   uint8_t opCode = (toSend && _sent == toSend)?_opcode:(uint8_t)WS_CONTINUATION;
+  if(_compressed && opCode != WS_CONTINUATION)
+    opCode |= WS_RSV1_COMPRESSED;
 
   size_t sent = webSocketSendFrame(client, final, opCode, _mask, dPtr, toSend);
   _status = WS_MSG_SENDING;
@@ -365,18 +444,30 @@ AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
   return sent;
 }
 
-// bool AsyncWebSocketBasicMessage::reserve(size_t size) { 
-//   if (size) {
-//     _data = (uint8_t*)malloc(size +1);
-//     if (_data) {
-//       memset(_data, 0, size); 
-//       _len = size; 
-//       _status = WS_MSG_SENDING;
-//       return true; 
-//     }
-//   }
-//   return false; 
-//  }
+bool AsyncWebSocketBasicMessage::deflate(AsyncWebDeflater *deflater){
+  if(deflater == NULL || _compressed || _sent || _data == NULL || _len < WS_DEFLATE_MIN_SIZE)
+    return false;
+  uint8_t * out = (uint8_t*)malloc(_len + 1);
+  if(out == NULL)
+    return false;
+  size_t outLen = deflater->compress(_data, _len, out, _len - 1);
+  if(!outLen){
+    free(out);
+    return false;
+  }
+  uint8_t * shrunk = (uint8_t*)realloc(out, outLen + 1);
+  if(shrunk != NULL)
+    out = shrunk;
+  out[outLen] = 0;
+  if(_string.length())
+    _string = String();
+  else
+    free(_data);
+  _data = out;
+  _len = outLen;
+  _compressed = true;
+  return true;
+}
 
 
 /*
@@ -384,7 +475,7 @@ AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
  */
 
 
-AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, bool mask)
+AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, bool mask, bool compressed)
   :_len(0)
   ,_sent(0)
   ,_ack(0)
@@ -394,6 +485,7 @@ AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuff
 
   _opcode = opcode & 0x07;
   _mask = mask;
+  _compressed = compressed;
 
   if (buffer) {
     _WSbuffer = buffer; 
@@ -453,6 +545,8 @@ AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
   bool final = (_sent == _len);
   uint8_t* dPtr = (uint8_t*)(_data + (_sent - toSend));
   uint8_t opCode = (toSend && _sent == toSend)?_opcode:(uint8_t)WS_CONTINUATION;
+  if(_compressed && opCode != WS_CONTINUATION)
+    opCode |= WS_RSV1_COMPRESSED;
 
   size_t sent = webSocketSendFrame(client, final, opCode, _mask, dPtr, toSend);
   _status = WS_MSG_SENDING;
@@ -472,9 +566,17 @@ AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
  const char * AWSC_PING_PAYLOAD = "ESPAsyncWebServer-PING";
  const size_t AWSC_PING_PAYLOAD_LEN = 22;
 
-AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server)
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server, const AwsDeflateParams *deflate)
   : _controlQueue(LinkedList<AsyncWebSocketControl *>([](AsyncWebSocketControl *c){ delete  c; }))
   , _messageQueue(LinkedList<AsyncWebSocketMessage *>([](AsyncWebSocketMessage *m){ delete  m; }))
+  , _deflater(NULL)
+  , _inflater(NULL)
+  , _rxBuffer(NULL)
+  , _rxLen(0)
+  , _rxLimit(0)
+  , _rxCompressed(false)
+  , _rxDiscard(false)
+  , _rxOpcode(WS_TEXT)
   , _tempObject(NULL)
 {
   _client = request->client();
@@ -483,7 +585,24 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _status = WS_CONNECTED;
   _pstate = 0;
   _lastMessageTime = millis();
-  _keepAlivePeriod = 0;
+  _keepAlivePeriod = _server->keepAlivePeriod() * 1000;
+  _pongTimeout = _server->pongTimeout() * 1000;
+  _maxMissedPongs = _server->maxMissedPongs();
+  _missedPongs = 0;
+  _awaitingPong = false;
+  AsyncWebSocketTimerWheel::init(&_timer, this);
+  _queuedBytes = 0;
+  _queuedMessages = 0;
+  _peakQueuedBytes = 0;
+  _droppedMessages = 0;
+  _maxQueuedBytes = _server->queueLimit();
+  _maxQueuedMessages = _server->queueLimitMessages();
+  _queuePolicy = _server->queuePolicy();
+  if(deflate != NULL){
+    _rxLimit = _server->deflateMemoryLimit();
+    _deflater = new AsyncWebDeflater(deflate->serverMaxWindowBits, deflate->serverNoContextTakeover);
+    _inflater = new AsyncWebInflater(deflate->clientMaxWindowBits, deflate->clientNoContextTakeover, _rxLimit);
+  }
   _client->setRxTimeout(0);
   _client->onError([](void *r, AsyncClient* c, int8_t error){ ((AsyncWebSocketClient*)(r))->_onError(error); }, this);
   _client->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ ((AsyncWebSocketClient*)(r))->_onAck(len, time); }, this);
@@ -492,13 +611,23 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _client->onData([](void *r, AsyncClient* c, void *buf, size_t len){ ((AsyncWebSocketClient*)(r))->_onData(buf, len); }, this);
   _client->onPoll([](void *r, AsyncClient* c){ ((AsyncWebSocketClient*)(r))->_onPoll(); }, this);
   _server->_addClient(this);
+  if(_keepAlivePeriod)
+    _server->_scheduleTimer(this, _lastMessageTime + _keepAlivePeriod);
   _server->_handleEvent(this, WS_EVT_CONNECT, NULL, NULL, 0);
   delete request;
 }
 
 AsyncWebSocketClient::~AsyncWebSocketClient(){
+  AsyncWebSocketTimerWheel::cancel(&_timer);
+  AWS_METRIC(wsQueuedBytes.add(-(int32_t)_queuedBytes));
   _messageQueue.free();
   _controlQueue.free();
+  if(_rxBuffer != NULL)
+    free(_rxBuffer);
+  if(_inflater != NULL)
+    delete _inflater;
+  if(_deflater != NULL)
+    delete _deflater;
   _server->_handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
 }
 
@@ -520,32 +649,108 @@ void AsyncWebSocketClient::_onAck(size_t len, uint32_t time){
   if(len && !_messageQueue.isEmpty()){
     _messageQueue.front()->ack(len, time);
   }
+  //messages published by other tasks go out while the window is open
+  _server->_drainPublishQueue();
   _server->_cleanBuffers(); 
   _runQueue();
 }
 
 void AsyncWebSocketClient::_onPoll(){
+  _server->_drainPublishQueue();
   if(_client->canSend() && (!_controlQueue.isEmpty() || !_messageQueue.isEmpty())){
     _runQueue();
-  } else if(_keepAlivePeriod > 0 && _controlQueue.isEmpty() && _messageQueue.isEmpty() && (millis() - _lastMessageTime) >= _keepAlivePeriod){
-    ping((uint8_t *)AWSC_PING_PAYLOAD, AWSC_PING_PAYLOAD_LEN);
   }
+  //keep-alive of all clients is driven from here, this client may be gone afterwards
+  _server->_runTimers();
+}
+
+void AsyncWebSocketClient::keepAlivePeriod(uint16_t seconds){
+  _keepAlivePeriod = seconds * 1000;
+  _awaitingPong = false;
+  _missedPongs = 0;
+  if(_keepAlivePeriod)
+    _server->_scheduleTimer(this, _lastMessageTime + _keepAlivePeriod);
+  else
+    AsyncWebSocketTimerWheel::cancel(&_timer);
+}
+
+void AsyncWebSocketClient::_onKeepAlive(){
+  uint32_t now = millis();
+  if(_status != WS_CONNECTED || !_keepAlivePeriod)
+    return;
+  if(_awaitingPong){
+    //_onData clears the flag, so the peer stayed silent since the last ping
+    if(++_missedPongs >= _maxMissedPongs){
+      _client->close(true);
+      return;
+    }
+  } else if((now - _lastMessageTime) < _keepAlivePeriod){
+    _server->_scheduleTimer(this, _lastMessageTime + _keepAlivePeriod);
+    return;
+  }
+  _awaitingPong = true;
+  ping((uint8_t *)AWSC_PING_PAYLOAD, AWSC_PING_PAYLOAD_LEN);
+  _server->_scheduleTimer(this, now + (_pongTimeout ? _pongTimeout : _keepAlivePeriod));
 }
 
 void AsyncWebSocketClient::_runQueue(){
   while(!_messageQueue.isEmpty() && _messageQueue.front()->finished()){
-    _messageQueue.remove(_messageQueue.front());
+    AsyncWebSocketMessage * m = _messageQueue.front();
+    _queuedBytes -= m->length();
+    AWS_METRIC(wsQueuedBytes.add(-(int32_t)m->length()));
+    _queuedMessages--;
+    _messageQueue.remove(m);
   }
 
   if(!_controlQueue.isEmpty() && (_messageQueue.isEmpty() || _messageQueue.front()->betweenFrames()) && webSocketSendFrameWindow(_client) > (size_t)(_controlQueue.front()->len() - 1)){
     _controlQueue.front()->send(_client);
   } else if(!_messageQueue.isEmpty() && _messageQueue.front()->betweenFrames() && webSocketSendFrameWindow(_client)){
-    _messageQueue.front()->send(_client);
+    AsyncWebSocketMessage * m = _messageQueue.front();
+    //with context takeover every compressed message becomes part of the peer's window,
+    //so a message is compressed only here, once nothing can drop it any more
+    if(_deflater != NULL && !m->started()){
+      size_t len = m->length();
+      if(m->deflate(_deflater)){
+        _queuedBytes -= len - m->length();
+        AWS_METRIC(wsQueuedBytes.add(-(int32_t)(len - m->length())));
+      }
+    }
+    m->send(_client);
   }
 }
 
 bool AsyncWebSocketClient::queueIsFull(){
-  if((_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES) || (_status != WS_CONNECTED) ) return true;
+  if(!canSend() || (_status != WS_CONNECTED) ) return true;
+  return false;
+}
+
+bool AsyncWebSocketClient::_queueFits(size_t len) const {
+  //an empty queue always takes the message, otherwise it could never be sent
+  if(!_queuedMessages)
+    return true;
+  return _queuedMessages < _maxQueuedMessages && (_queuedBytes + len) <= _maxQueuedBytes;
+}
+
+void AsyncWebSocketClient::_dropMessage(AsyncWebSocketMessage *dataMessage){
+  _droppedMessages++;
+  _server->_handleDrop();
+  delete dataMessage;
+}
+
+bool AsyncWebSocketClient::_dropOldest(){
+  //the message at the front may already be on the wire and has to stay
+  for(const auto& m: _messageQueue){
+    if(!m->started()){
+      AsyncWebSocketMessage * dropped = m;
+      _queuedBytes -= dropped->length();
+      AWS_METRIC(wsQueuedBytes.add(-(int32_t)dropped->length()));
+      _queuedMessages--;
+      _droppedMessages++;
+      _server->_handleDrop();
+      _messageQueue.remove(dropped);
+      return true;
+    }
+  }
   return false;
 }
 
@@ -556,12 +761,43 @@ void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage){
     delete dataMessage;
     return;
   }
-  if(_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES){
-      ets_printf("ERROR: Too many messages queued\n");
-      delete dataMessage;
-  } else {
-      _messageQueue.add(dataMessage);
+  size_t len = dataMessage->length();
+  if(_queuePolicy == WS_QUEUE_COALESCE && dataMessage->key()){
+    //keep only the latest state for the key
+    uint32_t key = dataMessage->key();
+    for(const auto& m: _messageQueue){
+      if(m->key() == key && !m->started()){
+        AsyncWebSocketMessage * stale = m;
+        _queuedBytes -= stale->length();
+        AWS_METRIC(wsQueuedBytes.add(-(int32_t)stale->length()));
+        _queuedMessages--;
+        _messageQueue.remove(stale);
+        break;
+      }
+    }
+  }
+  if(!_queueFits(len)){
+    if(_queuePolicy == WS_QUEUE_DISCONNECT){
+      _dropMessage(dataMessage);
+      close(1008, "Slow consumer");
+      return;
+    }
+    if(_queuePolicy == WS_QUEUE_DROP_OLDEST){
+      while(!_queueFits(len) && _dropOldest());
+    }
+    if(!_queueFits(len)){
+      _dropMessage(dataMessage);
+      if(_client->canSend())
+        _runQueue();
+      return;
+    }
   }
+  _messageQueue.add(dataMessage);
+  _queuedBytes += len;
+  AWS_METRIC(wsQueuedBytes.add(len));
+  _queuedMessages++;
+  if(_queuedBytes > _peakQueuedBytes)
+    _peakQueuedBytes = _queuedBytes;
   if(_client->canSend())
     _runQueue();
 }
@@ -617,6 +853,8 @@ void AsyncWebSocketClient::_onDisconnect(){
 
 void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   _lastMessageTime = millis();
+  _awaitingPong = false;
+  _missedPongs = 0;
   uint8_t *data = (uint8_t*)pbuf;
   while(plen > 0){
     if(!_pstate){
@@ -626,6 +864,13 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
       _pinfo.opcode = fdata[0] & 0x0F;
       _pinfo.masked = (fdata[1] & 0x80) != 0;
       _pinfo.len = fdata[1] & 0x7F;
+      _pinfo.compressed = 0;
+      if(_pinfo.opcode == WS_TEXT || _pinfo.opcode == WS_BINARY){
+        //RSV1 on the first frame marks a compressed message
+        _rxOpcode = _pinfo.opcode;
+        _rxCompressed = _inflater != NULL && (fdata[0] & WS_RSV1_COMPRESSED) != 0;
+        _rxDiscard = false;
+      }
       data += 2;
       plen -= 2;
       if(_pinfo.len == 126){
@@ -662,7 +907,11 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
           _pinfo.num = 0;
         } else _pinfo.num += 1;
       }
-      _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
+      //control frames can come between the frames of a compressed message
+      if(_pinfo.opcode >= 8 || (!_rxCompressed && !_rxDiscard))
+        _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
+      else if(_rxCompressed)
+        _onCompressedData((uint8_t*)data, datalen, false);
 
       _pinfo.index += datalen;
     } else if((datalen + _pinfo.index) == _pinfo.len){
@@ -688,7 +937,12 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
         if(datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
           _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
       } else if(_pinfo.opcode < 8){//continuation or text/binary frame
-        _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, datalen);
+        if(_rxDiscard)
+          _rxDiscard = !_pinfo.final;
+        else if(_rxCompressed)
+          _onCompressedData(data, datalen, _pinfo.final);
+        else
+          _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, datalen);
       }
     } else {
       //os_printf("frame error: len: %u, index: %llu, total: %llu\n", datalen, _pinfo.index, _pinfo.len);
@@ -705,68 +959,109 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   }
 }
 
+void AsyncWebSocketClient::_onCompressedData(uint8_t *data, size_t len, bool last){
+  //compressed messages are collected and inflated as a whole
+  bool tooBig = _rxLen + len > _rxLimit;
+  uint8_t * grown = NULL;
+  if(!tooBig && len){
+    grown = (uint8_t*)realloc(_rxBuffer, _rxLen + len);
+  }
+  if(tooBig || (len && grown == NULL)){
+    if(_rxBuffer != NULL)
+      free(_rxBuffer);
+    _rxBuffer = NULL;
+    _rxLen = 0;
+    _rxCompressed = false;
+    //the frames still to come are not raised as plain data
+    _rxDiscard = !last;
+    if(tooBig)
+      close(1009, "Message too big");
+    else
+      close(1011);
+    return;
+  }
+  if(len){
+    _rxBuffer = grown;
+    memcpy(_rxBuffer + _rxLen, data, len);
+    _rxLen += len;
+  }
+  if(!last)
+    return;
+
+  bool ok = _inflater->decompress(_rxBuffer, _rxLen);
+  if(_rxBuffer != NULL)
+    free(_rxBuffer);
+  _rxBuffer = NULL;
+  _rxLen = 0;
+  _rxCompressed = false;
+  if(!ok){
+    close(1007, "Invalid compressed data");
+    return;
+  }
+
+  AwsFrameInfo info = _pinfo;
+  info.message_opcode = _rxOpcode;
+  info.opcode = _rxOpcode;
+  info.num = 0;
+  info.final = 1;
+  info.index = 0;
+  info.len = _inflater->length();
+  info.compressed = 1;
+  _server->_handleEvent(this, WS_EVT_DATA, (void *)&info, _inflater->data(), _inflater->length());
+  _inflater->reset();
+}
+
+size_t AsyncWebSocketClient::_printf(bool progmem, const char * format, va_list arg){
+  AsyncWebSocketBasicMessage * m = webSocketFormatMessage(progmem, format, arg);
+  if(m == NULL)
+    return 0;
+  size_t len = m->length();
+  _queueMessage(_prepareMessage(m));
+  return len;
+}
+
 size_t AsyncWebSocketClient::printf(const char *format, ...) {
   va_list arg;
   va_start(arg, format);
-  char* temp = new char[MAX_PRINTF_LEN];
-  if(!temp){
-    return 0;
-  }
-  char* buffer = temp;
-  size_t len = vsnprintf(temp, MAX_PRINTF_LEN, format, arg);
+  size_t len = _printf(false, format, arg);
   va_end(arg);
-
-  if (len > (MAX_PRINTF_LEN - 1)) {
-    buffer = new char[len + 1];
-    if (!buffer) {
-   	  delete[] temp;
-      return 0;
-    }
-    va_start(arg, format);
-    vsnprintf(buffer, len + 1, format, arg);
-    va_end(arg);
-  }
-  text(buffer, len);
-  if (buffer != temp) {
-    delete[] buffer;
-  }
-  delete[] temp;
   return len;
 }
 
-#ifndef ESP32
+#if !defined(ESP32) && !defined(ASYNCWEBSERVER_HOST)
 size_t AsyncWebSocketClient::printf_P(PGM_P formatP, ...) {
   va_list arg;
   va_start(arg, formatP);
-  char* temp = new char[MAX_PRINTF_LEN];
-  if(!temp){
-    return 0;
-  }
-  char* buffer = temp;
-  size_t len = vsnprintf_P(temp, MAX_PRINTF_LEN, formatP, arg);
+  size_t len = _printf(true, formatP, arg);
   va_end(arg);
-
-  if (len > (MAX_PRINTF_LEN - 1)) {
-    buffer = new char[len + 1];
-    if (!buffer) {
-   	  delete[] temp;
-      return 0;
-    }
-    va_start(arg, formatP);
-    vsnprintf_P(buffer, len + 1, formatP, arg);
-    va_end(arg);
-  }
-  text(buffer, len);
-  if (buffer != temp) {
-    delete[] buffer;
-  }
-  delete[] temp;
   return len;
 }
 #endif
 
+AsyncWebSocketMessage * AsyncWebSocketClient::_prepareMessage(AsyncWebSocketBasicMessage * message, uint32_t key){
+  if(message == NULL)
+    return NULL;
+  //compressed by _runQueue when it is sent
+  message->key(key);
+  return message;
+}
+
+AsyncWebSocketMessage * AsyncWebSocketClient::_newMessage(const char * message, size_t len, uint8_t opcode, uint32_t key){
+  return _prepareMessage(new AsyncWebSocketBasicMessage(message, len, opcode), key);
+}
+
+AsyncWebSocketMessage * AsyncWebSocketClient::_newMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key){
+  //shared buffers can not be compressed in place, the client gets its own copy to compress
+  if(_deflater != NULL && buffer != NULL && buffer->length() >= WS_DEFLATE_MIN_SIZE)
+    return _newMessage((const char *)buffer->get(), buffer->length(), opcode, key);
+  AsyncWebSocketMessage * m = new AsyncWebSocketMultiMessage(buffer, opcode);
+  if(m != NULL)
+    m->key(key);
+  return m;
+}
+
 void AsyncWebSocketClient::text(const char * message, size_t len){
-  _queueMessage(new AsyncWebSocketBasicMessage(message, len));
+  _queueMessage(_newMessage(message, len, WS_TEXT));
 }
 void AsyncWebSocketClient::text(const char * message){
   text(message, strlen(message));
@@ -780,29 +1075,31 @@ void AsyncWebSocketClient::text(char * message){
 void AsyncWebSocketClient::text(const String &message){
   text(message.c_str(), message.length());
 }
+void AsyncWebSocketClient::text(String &&message){
+  _queueMessage(_prepareMessage(new AsyncWebSocketBasicMessage(std::move(message), WS_TEXT)));
+}
 void AsyncWebSocketClient::text(const __FlashStringHelper *data){
-  PGM_P p = reinterpret_cast<PGM_P>(data);
-  size_t n = 0;
-  while (1) {
-    if (pgm_read_byte(p+n) == 0) break;
-      n += 1;
-  }
-  char * message = (char*) malloc(n+1);
-  if(message){
-    for(size_t b=0; b<n; b++)
-      message[b] = pgm_read_byte(p++);
-    message[n] = 0;
-    text(message, n);
-    free(message);
-  }
+  _queueMessage(_prepareMessage(webSocketFlashMessage(reinterpret_cast<PGM_P>(data), strlen_P(reinterpret_cast<PGM_P>(data)), WS_TEXT)));
 }
 void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer * buffer)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer));
+  _queueMessage(_newMessage(buffer, WS_TEXT));
+}
+
+bool AsyncWebSocketClient::subscribe(const String& topic){
+  return _server->subscribe(_clientId, topic);
+}
+
+bool AsyncWebSocketClient::unsubscribe(const String& topic){
+  return _server->unsubscribe(_clientId, topic);
+}
+
+void AsyncWebSocketClient::text(const char * message, size_t len, uint32_t key){
+  _queueMessage(_newMessage(message, len, WS_TEXT, key));
 }
 
 void AsyncWebSocketClient::binary(const char * message, size_t len){
-  _queueMessage(new AsyncWebSocketBasicMessage(message, len, WS_BINARY));
+  _queueMessage(_newMessage(message, len, WS_BINARY));
 }
 void AsyncWebSocketClient::binary(const char * message){
   binary(message, strlen(message));
@@ -816,20 +1113,19 @@ void AsyncWebSocketClient::binary(char * message){
 void AsyncWebSocketClient::binary(const String &message){
   binary(message.c_str(), message.length());
 }
+void AsyncWebSocketClient::binary(String &&message){
+  _queueMessage(_prepareMessage(new AsyncWebSocketBasicMessage(std::move(message), WS_BINARY)));
+}
 void AsyncWebSocketClient::binary(const __FlashStringHelper *data, size_t len){
-  PGM_P p = reinterpret_cast<PGM_P>(data);
-  char * message = (char*) malloc(len);
-  if(message){
-    for(size_t b=0; b<len; b++)
-      message[b] = pgm_read_byte(p++);
-    binary(message, len);
-    free(message); 
-  }
-  
+  _queueMessage(_prepareMessage(webSocketFlashMessage(reinterpret_cast<PGM_P>(data), len, WS_BINARY)));
 }
 void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer * buffer)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer, WS_BINARY));
+  _queueMessage(_newMessage(buffer, WS_BINARY));
+}
+
+void AsyncWebSocketClient::binary(const char * message, size_t len, uint32_t key){
+  _queueMessage(_newMessage(message, len, WS_BINARY, key));
 }
 
 IPAddress AsyncWebSocketClient::remoteIP() {
@@ -855,14 +1151,46 @@ uint16_t AsyncWebSocketClient::remotePort() {
 AsyncWebSocket::AsyncWebSocket(const String& url)
   :_url(url)
   ,_clients(LinkedList<AsyncWebSocketClient *>([](AsyncWebSocketClient *c){ delete c; }))
+  ,_topics(LinkedList<AsyncWebSocketTopic *>([](AsyncWebSocketTopic *t){ delete t; }))
   ,_cNextId(1)
   ,_enabled(true)
+  ,_deflateEnabled(false)
+  ,_deflateLimit(WS_DEFLATE_MEMORY_LIMIT)
+  ,_deflater(NULL)
+  ,_maxQueuedBytes(WS_MAX_QUEUED_BYTES)
+  ,_maxQueuedMessages(WS_MAX_QUEUED_MESSAGES)
+  ,_queuePolicy(WS_QUEUE_DROP_NEWEST)
+  ,_droppedMessages(0)
+  ,_keepAlivePeriod(0)
+  ,_pongTimeout(WS_PONG_TIMEOUT)
+  ,_maxMissedPongs(WS_MAX_MISSED_PONGS)
+  ,_publishQueue(WS_PUBLISH_QUEUE_LENGTH)
   ,_buffers(LinkedList<AsyncWebSocketMessageBuffer *>([](AsyncWebSocketMessageBuffer *b){ delete b; }))
 {
   _eventHandler = NULL;
+  _deflateConfig.serverMaxWindowBits = 10;
+  _deflateConfig.clientMaxWindowBits = 10;
+  _deflateConfig.serverNoContextTakeover = true;
+  _deflateConfig.clientNoContextTakeover = true;
 }
 
-AsyncWebSocket::~AsyncWebSocket(){}
+AsyncWebSocket::~AsyncWebSocket(){
+  AwsPublishEntry entry;
+  while(_publishQueue.pop(entry))
+    delete entry.buffer;
+  _topics.free();
+  if(_deflater != NULL)
+    delete _deflater;
+}
+
+void AsyncWebSocket::deflateWindowBits(uint8_t serverBits, uint8_t clientBits){
+  _deflateConfig.serverMaxWindowBits = std::min((uint8_t)15, std::max((uint8_t)8, serverBits));
+  _deflateConfig.clientMaxWindowBits = std::min((uint8_t)15, std::max((uint8_t)8, clientBits));
+  if(_deflater != NULL){
+    delete _deflater;
+    _deflater = NULL;
+  }
+}
 
 void AsyncWebSocket::_handleEvent(AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len){
   if(_eventHandler != NULL){
@@ -871,14 +1199,26 @@ void AsyncWebSocket::_handleEvent(AsyncWebSocketClient * client, AwsEventType ty
 }
 
 void AsyncWebSocket::_addClient(AsyncWebSocketClient * client){
+  //anything published before the client existed is not meant for it
+  _drainPublishQueue();
   _clients.add(client);
+  _clientIndex[client->id()] = client;
+  AWS_METRIC(wsClients.inc());
 }
 
 void AsyncWebSocket::_handleDisconnect(AsyncWebSocketClient * client){
-  
+  AsyncWebSocketTimerWheel::cancel(&client->_timer);
+  unsubscribeAll(client->id());
+  _clientIndex.erase(client->id());
+  AWS_METRIC(wsClients.dec());
   _clients.remove_first([=](AsyncWebSocketClient * c){
     return c->id() == client->id();
   });
+  //what was queued while the last client left is freed now, not when the next one connects
+  if(_clients.isEmpty()){
+    _drainPublishQueue();
+    _cleanBuffers();
+  }
 }
 
 bool AsyncWebSocket::availableForWriteAll(){
@@ -895,6 +1235,14 @@ bool AsyncWebSocket::availableForWrite(uint32_t id){
   return true;
 }
 
+size_t AsyncWebSocket::queuedBytes() const {
+  size_t bytes = 0;
+  for(const auto& c: _clients){
+    bytes += c->queuedBytes();
+  }
+  return bytes;
+}
+
 size_t AsyncWebSocket::count() const {
   return _clients.count_if([](AsyncWebSocketClient * c){
     return c->status() == WS_CONNECTED;
@@ -902,14 +1250,263 @@ size_t AsyncWebSocket::count() const {
 }
 
 AsyncWebSocketClient * AsyncWebSocket::client(uint32_t id){
-  for(const auto &c: _clients){
-    if(c->id() == id && c->status() == WS_CONNECTED){
-      return c;
-    }
+  auto it = _clientIndex.find(id);
+  if(it != _clientIndex.end() && it->second->status() == WS_CONNECTED){
+    return it->second;
   }
   return nullptr;
 }
 
+/*
+ * Keep-Alive Timer Wheel
+ * */
+
+AsyncWebSocketTimerWheel::AsyncWebSocketTimerWheel()
+  :_tick(0)
+  ,_time(0)
+  ,_running(false)
+{
+  for(size_t i = 0; i < WS_TIMER_WHEEL_SLOTS; i++){
+    _slots[i].prev = &_slots[i];
+    _slots[i].next = &_slots[i];
+    _slots[i].client = NULL;
+    _slots[i].deadline = 0;
+  }
+}
+
+void AsyncWebSocketTimerWheel::init(AwsTimerNode * node, AsyncWebSocketClient * client){
+  node->prev = NULL;
+  node->next = NULL;
+  node->client = client;
+  node->deadline = 0;
+}
+
+void AsyncWebSocketTimerWheel::_link(AwsTimerNode * head, AwsTimerNode * node){
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+}
+
+void AsyncWebSocketTimerWheel::cancel(AwsTimerNode * node){
+  if(!scheduled(node))
+    return;
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = NULL;
+  node->next = NULL;
+}
+
+void AsyncWebSocketTimerWheel::schedule(AwsTimerNode * node, uint32_t deadline){
+  cancel(node);
+  if(!_running){
+    _time = millis();
+    _running = true;
+  }
+  node->deadline = deadline;
+  //deadlines further out than one turn are checked again when their slot comes around
+  int32_t delta = (int32_t)(deadline - _time);
+  uint32_t ticks = (delta <= 0) ? 1 : (uint32_t)((delta + WS_TIMER_WHEEL_TICK - 1) / WS_TIMER_WHEEL_TICK);
+  if(ticks > WS_TIMER_WHEEL_SLOTS)
+    ticks = WS_TIMER_WHEEL_SLOTS;
+  _link(&_slots[(_tick + ticks) % WS_TIMER_WHEEL_SLOTS], node);
+}
+
+void AsyncWebSocketTimerWheel::advance(uint32_t now, AwsTimerNode * due){
+  if(!_running)
+    return;
+  size_t steps = 0;
+  while((now - _time) >= WS_TIMER_WHEEL_TICK && steps++ < WS_TIMER_WHEEL_SLOTS){
+    _time += WS_TIMER_WHEEL_TICK;
+    _tick++;
+    AwsTimerNode * head = &_slots[_tick % WS_TIMER_WHEEL_SLOTS];
+    AwsTimerNode * node = head->next;
+    while(node != head){
+      AwsTimerNode * next = node->next;
+      if((int32_t)(now - node->deadline) >= 0){
+        cancel(node);
+        _link(due, node);
+      }
+      node = next;
+    }
+  }
+  //after a long stall every slot was visited once, resync instead of spinning
+  if((now - _time) >= WS_TIMER_WHEEL_TICK)
+    _time = now;
+}
+
+void AsyncWebSocket::_runTimers(){
+  AwsTimerNode due;
+  due.prev = &due;
+  due.next = &due;
+  _timers.advance(millis(), &due);
+  //a handler may close and free any client, each one unlinks itself from the list
+  while(due.next != &due){
+    AwsTimerNode * node = due.next;
+    AsyncWebSocketTimerWheel::cancel(node);
+    node->client->_onKeepAlive();
+  }
+}
+
+/*
+ * Publish/Subscribe
+ * */
+
+bool AsyncWebSocketTopic::add(AsyncWebSocketClient * client){
+  for(const auto& c: _members){
+    if(c == client)
+      return false;
+  }
+  _members.push_back(client);
+  return true;
+}
+
+bool AsyncWebSocketTopic::remove(AsyncWebSocketClient * client){
+  for(size_t i = 0; i < _members.size(); i++){
+    if(_members[i] == client){
+      //order of delivery between subscribers does not matter
+      _members[i] = _members.back();
+      _members.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+AsyncWebSocketTopic * AsyncWebSocket::_topic(const char * name){
+  for(const auto& t: _topics){
+    if(t->name() == name)
+      return t;
+  }
+  return NULL;
+}
+
+bool AsyncWebSocket::subscribe(uint32_t id, const String& topic){
+  AsyncWebSocketClient * c = client(id);
+  if(c == NULL)
+    return false;
+  AsyncWebSocketTopic * t = _topic(topic.c_str());
+  if(t == NULL){
+    t = new AsyncWebSocketTopic(topic);
+    if(t == NULL)
+      return false;
+    _topics.add(t);
+  }
+  return t->add(c);
+}
+
+bool AsyncWebSocket::unsubscribe(uint32_t id, const String& topic){
+  auto it = _clientIndex.find(id);
+  if(it == _clientIndex.end())
+    return false;
+  AsyncWebSocketTopic * t = _topic(topic.c_str());
+  if(t == NULL || !t->remove(it->second))
+    return false;
+  if(!t->count())
+    _topics.remove(t);
+  return true;
+}
+
+void AsyncWebSocket::unsubscribeAll(uint32_t id){
+  auto it = _clientIndex.find(id);
+  if(it == _clientIndex.end())
+    return;
+  AsyncWebSocketClient * c = it->second;
+  for(const auto& t: _topics){
+    t->remove(c);
+  }
+  while(_topics.remove_first([](AsyncWebSocketTopic * t){ return !t->count(); }));
+}
+
+size_t AsyncWebSocket::subscribers(const String& topic){
+  AsyncWebSocketTopic * t = _topic(topic.c_str());
+  return t ? t->count() : 0;
+}
+
+void AsyncWebSocket::publish(const String& topic, AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key){
+  if(!buffer) return;
+  _publish(_topic(topic.c_str()), buffer, opcode, key);
+}
+
+void AsyncWebSocket::_publish(AsyncWebSocketTopic * t, AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key){
+  if(t == NULL){
+    //nobody listens, let the buffer be released
+    buffer->lock();
+    buffer->unlock();
+    _cleanBuffers();
+    return;
+  }
+  _bufferAll(buffer, opcode, key, &t->members());
+}
+
+void AsyncWebSocket::publish(const String& topic, const char * message, size_t len, uint8_t opcode, uint32_t key){
+  if(_topic(topic.c_str()) == NULL)
+    return;
+  publish(topic, makeBuffer((uint8_t *)message, len), opcode, key);
+}
+
+void AsyncWebSocket::publish(const String& topic, const String& message){
+  publish(topic, message.c_str(), message.length());
+}
+
+
+bool AsyncWebSocket::_tryPublish(const char * topic, const uint8_t * data, size_t len, uint8_t opcode, uint32_t key){
+  //no client would drain the queue, and there is nobody to send to
+  if(_clients.isEmpty())
+    return true;
+  //not tracked in _buffers yet, that list belongs to the network task.
+  //the topic goes in the same allocation, after the terminated payload
+  size_t topicLen = topic ? strlen(topic) : 0;
+  AsyncWebSocketMessageBuffer * buffer = new AsyncWebSocketMessageBuffer(len + (topicLen ? topicLen + 1 : 0));
+  if(buffer == NULL)
+    return false;
+  if(buffer->get() == NULL){
+    delete buffer;
+    return false;
+  }
+  memcpy(buffer->get(), data, len);
+  buffer->get()[len] = 0;
+  AwsPublishEntry entry;
+  entry.buffer = buffer;
+  entry.opcode = opcode;
+  entry.key = key;
+  entry.topic = NULL;
+  if(topicLen){
+    memcpy(buffer->get() + len + 1, topic, topicLen + 1);
+    entry.topic = (const char *)buffer->get() + len + 1;
+    buffer->_len = len;
+  }
+  if(!_publishQueue.push(entry)){
+    delete buffer;
+    return false;
+  }
+  return true;
+}
+
+bool AsyncWebSocket::tryTextAll(const char * message, size_t len, uint32_t key){
+  return _tryPublish(NULL, (const uint8_t *)message, len, WS_TEXT, key);
+}
+
+bool AsyncWebSocket::tryBinaryAll(const uint8_t * message, size_t len, uint32_t key){
+  return _tryPublish(NULL, message, len, WS_BINARY, key);
+}
+
+bool AsyncWebSocket::tryPublish(const String& topic, const char * message, size_t len, uint8_t opcode, uint32_t key){
+  if(!topic.length())
+    return false;
+  return _tryPublish(topic.c_str(), (const uint8_t *)message, len, opcode, key);
+}
+
+void AsyncWebSocket::_drainPublishQueue(){
+  AwsPublishEntry entry;
+  while(_publishQueue.pop(entry)){
+    _buffers.add(entry.buffer);
+    if(entry.topic != NULL)
+      _publish(_topic(entry.topic), entry.buffer, entry.opcode, entry.key);
+    else
+      _bufferAll(entry.buffer, entry.opcode, entry.key);
+  }
+}
 
 void AsyncWebSocket::close(uint32_t id, uint16_t code, const char * message){
   AsyncWebSocketClient * c = client(id);
@@ -943,18 +1540,75 @@ void AsyncWebSocket::text(uint32_t id, const char * message, size_t len){
     c->text(message, len);
 }
 
-void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer){
+AsyncWebSocketMessageBuffer * AsyncWebSocket::_deflateBuffer(AsyncWebSocketMessageBuffer * buffer){
+  if(buffer->length() < WS_DEFLATE_MIN_SIZE)
+    return NULL;
+  if(_deflater == NULL)
+    _deflater = new AsyncWebDeflater(_deflateConfig.serverMaxWindowBits, true);
+  if(_deflater == NULL)
+    return NULL;
+  AsyncWebSocketMessageBuffer * deflated = makeBuffer(buffer->length());
+  if(deflated == NULL)
+    return NULL;
+  size_t len = _deflater->compress(buffer->get(), buffer->length(), deflated->get(), buffer->length() - 1);
+  if(!len)
+    return NULL;
+  deflated->_len = len;
+  deflated->_data[len] = 0;
+  return deflated;
+}
+
+void AsyncWebSocket::_bufferAll(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key, const std::vector<AsyncWebSocketClient *> *members){
   if (!buffer) return;
   buffer->lock(); 
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED){
-        c->text(buffer);
+  //clients without compression history share one compressed copy of the payload
+  AsyncWebSocketMessageBuffer * deflated = NULL;
+  bool deflateTried = false;
+  auto send = [&](AsyncWebSocketClient * c){
+    if(c->status() != WS_CONNECTED)
+      return;
+    if(c->_deflater != NULL && !c->_deflater->contextTakeover() && c->_deflater->windowBits() >= _deflateConfig.serverMaxWindowBits){
+      if(!deflateTried){
+        deflateTried = true;
+        deflated = _deflateBuffer(buffer);
+        if(deflated != NULL)
+          deflated->lock();
+      }
+      if(deflated != NULL){
+        AsyncWebSocketMessage * m = new AsyncWebSocketMultiMessage(deflated, opcode, false, true);
+        if(m != NULL)
+          m->key(key);
+        c->_queueMessage(m);
+        return;
+      }
     }
+    c->_queueMessage(c->_newMessage(buffer, opcode, key));
+  };
+  if(members != NULL){
+    for(const auto& c: *members)
+      send(c);
+  } else {
+    for(const auto& c: _clients)
+      send(c);
   }
+  if(deflated != NULL)
+    deflated->unlock();
   buffer->unlock();
   _cleanBuffers(); 
 }
 
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer){
+  _bufferAll(buffer, WS_TEXT);
+}
+
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key){
+  _bufferAll(buffer, WS_TEXT, key);
+}
+
+void AsyncWebSocket::textAll(const char * message, size_t len, uint32_t key){
+  _bufferAll(makeBuffer((uint8_t *)message, len), WS_TEXT, key);
+}
+
 
 void AsyncWebSocket::textAll(const char * message, size_t len){
   AsyncWebSocketMessageBuffer * WSBuffer = makeBuffer((uint8_t *)message, len); 
@@ -974,14 +1628,12 @@ void AsyncWebSocket::binaryAll(const char * message, size_t len){
 
 void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer)
 {
-  if (!buffer) return;
-  buffer->lock(); 
-    for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c->binary(buffer);
-  }
-  buffer->unlock(); 
-  _cleanBuffers(); 
+  _bufferAll(buffer, WS_BINARY);
+}
+
+void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key)
+{
+  _bufferAll(buffer, WS_BINARY, key);
 }
 
 void AsyncWebSocket::message(uint32_t id, AsyncWebSocketMessage *message){
@@ -1003,44 +1655,50 @@ size_t AsyncWebSocket::printf(uint32_t id, const char *format, ...){
   if(c){
     va_list arg;
     va_start(arg, format);
-    size_t len = c->printf(format, arg);
+    size_t len = c->_printf(false, format, arg);
     va_end(arg);
     return len;
   }
   return 0;
 }
 
-size_t AsyncWebSocket::printfAll(const char *format, ...) {
-  va_list arg;
-  char* temp = new char[MAX_PRINTF_LEN];
-  if(!temp){
+size_t AsyncWebSocket::_printfAll(bool progmem, const char * format, va_list arg){
+  char temp[MAX_PRINTF_LEN];
+  va_list copy;
+  va_copy(copy, arg);
+  int len = webSocketFormat(progmem, temp, MAX_PRINTF_LEN, format, copy);
+  va_end(copy);
+  if(len < 0)
     return 0;
-  }
-  va_start(arg, format);
-  size_t len = vsnprintf(temp, MAX_PRINTF_LEN, format, arg);
-  va_end(arg);
-  delete[] temp;
-  
+
   AsyncWebSocketMessageBuffer * buffer = makeBuffer(len); 
   if (!buffer) {
     return 0;
   }
+  if(len < MAX_PRINTF_LEN)
+    memcpy(buffer->get(), temp, len);
+  else
+    webSocketFormat(progmem, (char *)buffer->get(), len + 1, format, arg);
+
+  textAll(buffer);
+  return len;
+}
 
+size_t AsyncWebSocket::printfAll(const char *format, ...) {
+  va_list arg;
   va_start(arg, format);
-  vsnprintf( (char *)buffer->get(), len + 1, format, arg);
+  size_t len = _printfAll(false, format, arg);
   va_end(arg);
-
-  textAll(buffer);
   return len;
 }
 
-#ifndef ESP32
+#if !defined(ESP32) && !defined(ASYNCWEBSERVER_HOST)
 size_t AsyncWebSocket::printf_P(uint32_t id, PGM_P formatP, ...){
   AsyncWebSocketClient * c = client(id);
   if(c != NULL){
     va_list arg;
     va_start(arg, formatP);
-    size_t len = c->printf_P(formatP, arg);
+    size_t len = c->_printf(true, formatP, arg);
     va_end(arg);
     return len;
   }
@@ -1050,25 +1708,9 @@ size_t AsyncWebSocket::printf_P(uint32_t id, PGM_P formatP, ...){
 
 size_t AsyncWebSocket::printfAll_P(PGM_P formatP, ...) {
   va_list arg;
-  char* temp = new char[MAX_PRINTF_LEN];
-  if(!temp){
-    return 0;
-  }
   va_start(arg, formatP);
-  size_t len = vsnprintf_P(temp, MAX_PRINTF_LEN, formatP, arg);
+  size_t len = _printfAll(true, formatP, arg);
   va_end(arg);
-  delete[] temp;
-  
-  AsyncWebSocketMessageBuffer * buffer = makeBuffer(len + 1); 
-  if (!buffer) {
-    return 0;
-  }
-
-  va_start(arg, formatP);
-  vsnprintf_P((char *)buffer->get(), len + 1, formatP, arg);
-  va_end(arg);
-
-  textAll(buffer);
   return len;
 }
 
@@ -1084,6 +1726,11 @@ void AsyncWebSocket::text(uint32_t id, char * message){
 void AsyncWebSocket::text(uint32_t id, const String &message){
   text(id, message.c_str(), message.length());
 }
+void AsyncWebSocket::text(uint32_t id, String &&message){
+  AsyncWebSocketClient * c = client(id);
+  if(c != NULL)
+    c->text(std::move(message));
+}
 void AsyncWebSocket::text(uint32_t id, const __FlashStringHelper *message){
   AsyncWebSocketClient * c = client(id);
   if(c != NULL)
@@ -1102,9 +1749,12 @@ void AsyncWebSocket::textAll(const String &message){
   textAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::textAll(const __FlashStringHelper *message){
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c->text(message);
+  PGM_P p = reinterpret_cast<PGM_P>(message);
+  size_t len = strlen_P(p);
+  AsyncWebSocketMessageBuffer * buffer = makeBuffer(len);
+  if(buffer){
+    memcpy_P(buffer->get(), p, len);
+    textAll(buffer);
   }
 }
 void AsyncWebSocket::binary(uint32_t id, const char * message){
@@ -1119,6 +1769,11 @@ void AsyncWebSocket::binary(uint32_t id, char * message){
 void AsyncWebSocket::binary(uint32_t id, const String &message){
   binary(id, message.c_str(), message.length());
 }
+void AsyncWebSocket::binary(uint32_t id, String &&message){
+  AsyncWebSocketClient * c = client(id);
+  if(c != NULL)
+    c->binary(std::move(message));
+}
 void AsyncWebSocket::binary(uint32_t id, const __FlashStringHelper *message, size_t len){
   AsyncWebSocketClient * c = client(id);
   if(c != NULL)
@@ -1137,11 +1792,12 @@ void AsyncWebSocket::binaryAll(const String &message){
   binaryAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::binaryAll(const __FlashStringHelper *message, size_t len){
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c-> binary(message, len);
+  AsyncWebSocketMessageBuffer * buffer = makeBuffer(len);
+  if(buffer){
+    memcpy_P(buffer->get(), reinterpret_cast<PGM_P>(message), len);
+    binaryAll(buffer);
   }
- }
+}
 
 const char * WS_STR_CONNECTION = "Connection";
 const char * WS_STR_UPGRADE = "Upgrade";
@@ -1149,6 +1805,7 @@ const char * WS_STR_ORIGIN = "Origin";
 const char * WS_STR_VERSION = "Sec-WebSocket-Version";
 const char * WS_STR_KEY = "Sec-WebSocket-Key";
 const char * WS_STR_PROTOCOL = "Sec-WebSocket-Protocol";
+const char * WS_STR_EXTENSIONS = "Sec-WebSocket-Extensions";
 const char * WS_STR_ACCEPT = "Sec-WebSocket-Accept";
 const char * WS_STR_UUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
@@ -1165,6 +1822,7 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request){
   request->addInterestingHeader(WS_STR_VERSION);
   request->addInterestingHeader(WS_STR_KEY);
   request->addInterestingHeader(WS_STR_PROTOCOL);
+  request->addInterestingHeader(WS_STR_EXTENSIONS);
   return true;
 }
 
@@ -1184,7 +1842,13 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request){
     return;
   }
   AsyncWebHeader* key = request->getHeader(WS_STR_KEY);
-  AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
+  AwsDeflateParams deflate;
+  String extensions;
+  bool compressed = _deflateEnabled && request->hasHeader(WS_STR_EXTENSIONS)
+    && webSocketNegotiateDeflate(request->getHeader(WS_STR_EXTENSIONS)->value(), _deflateConfig, _deflateLimit, deflate, extensions);
+  AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this, compressed ? &deflate : NULL);
+  if(compressed)
+    response->addHeader(WS_STR_EXTENSIONS, extensions);
   if(request->hasHeader(WS_STR_PROTOCOL)){
     AsyncWebHeader* protocol = request->getHeader(WS_STR_PROTOCOL);
     //ToDo: check protocol
@@ -1228,8 +1892,11 @@ void AsyncWebSocket::_cleanBuffers()
  * Authentication code from https://github.com/Links2004/arduinoWebSockets/blob/master/src/WebSockets.cpp#L480
  */
 
-AsyncWebSocketResponse::AsyncWebSocketResponse(const String& key, AsyncWebSocket *server){
+AsyncWebSocketResponse::AsyncWebSocketResponse(const String& key, AsyncWebSocket *server, const AwsDeflateParams *deflate){
   _server = server;
+  _deflate = (deflate != NULL);
+  if(_deflate)
+    _deflateParams = *deflate;
   _code = 101;
   _sendContentLength = false;
 
@@ -1276,7 +1943,7 @@ void AsyncWebSocketResponse::_respond(AsyncWebServerRequest *request){
 
 size_t AsyncWebSocketResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time){
   if(len){
-    new AsyncWebSocketClient(request, _server);
+    new AsyncWebSocketClient(request, _server, _deflate ? &_deflateParams : NULL);
   }
   return 0;
 }
@@ -22,14 +22,50 @@
 #define ASYNCWEBSOCKET_H_
 
 #include <Arduino.h>
-#ifdef ESP32
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
 #include <AsyncTCP.h>
+#ifndef WS_MAX_QUEUED_MESSAGES
 #define WS_MAX_QUEUED_MESSAGES 32
+#endif
+#ifndef WS_MAX_QUEUED_BYTES
+#define WS_MAX_QUEUED_BYTES 16384
+#endif
+#ifndef WS_PUBLISH_QUEUE_LENGTH
+#define WS_PUBLISH_QUEUE_LENGTH 16
+#endif
 #else
 #include <ESPAsyncTCP.h>
+#ifndef WS_MAX_QUEUED_MESSAGES
 #define WS_MAX_QUEUED_MESSAGES 8
 #endif
+#ifndef WS_MAX_QUEUED_BYTES
+#define WS_MAX_QUEUED_BYTES 4096
+#endif
+#ifndef WS_PUBLISH_QUEUE_LENGTH
+#define WS_PUBLISH_QUEUE_LENGTH 8
+#endif
+#endif
 #include <ESPAsyncWebServer.h>
+#include "AsyncWebSocketDeflate.h"
+#include "AsyncWebPublishQueue.h"
+#include <vector>
+#include <unordered_map>
+
+//keep-alive timer wheel: number of slots and slot width in ms
+#ifndef WS_TIMER_WHEEL_SLOTS
+#define WS_TIMER_WHEEL_SLOTS 64
+#endif
+#ifndef WS_TIMER_WHEEL_TICK
+#define WS_TIMER_WHEEL_TICK 250
+#endif
+//seconds to wait for any frame after a keep-alive ping
+#ifndef WS_PONG_TIMEOUT
+#define WS_PONG_TIMEOUT 10
+#endif
+//unanswered keep-alive pings before the client is dropped
+#ifndef WS_MAX_MISSED_PONGS
+#define WS_MAX_MISSED_PONGS 2
+#endif
 
 #ifdef ESP8266
 #include <Hash.h>
@@ -62,12 +98,43 @@ typedef struct {
     uint8_t mask[4];
     /** Offset of the data inside the current frame. */
     uint64_t index;
+    /** Was the message compressed with permessage-deflate?
+     * Compressed messages are delivered inflated, as a single final frame. */
+    uint8_t compressed;
 } AwsFrameInfo;
 
 typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus;
 typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
 typedef enum { WS_MSG_SENDING, WS_MSG_SENT, WS_MSG_ERROR } AwsMessageStatus;
 typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+//what to do with a message that does not fit in the send queue of a client
+typedef enum { WS_QUEUE_DROP_NEWEST, WS_QUEUE_DROP_OLDEST, WS_QUEUE_COALESCE, WS_QUEUE_DISCONNECT } AwsQueuePolicy;
+
+//entry of the keep-alive timer wheel, linked into one slot at a time
+typedef struct AwsTimerNode {
+    struct AwsTimerNode * prev;
+    struct AwsTimerNode * next;
+    AsyncWebSocketClient * client;
+    uint32_t deadline;
+} AwsTimerNode;
+
+//hashed timer wheel. advancing it only visits the slots that passed since the last call
+class AsyncWebSocketTimerWheel {
+  private:
+    AwsTimerNode _slots[WS_TIMER_WHEEL_SLOTS];
+    uint32_t _tick;
+    uint32_t _time;
+    bool _running;
+    static void _link(AwsTimerNode * head, AwsTimerNode * node);
+  public:
+    AsyncWebSocketTimerWheel();
+    static void init(AwsTimerNode * node, AsyncWebSocketClient * client);
+    static bool scheduled(const AwsTimerNode * node){ return node->next != NULL; }
+    static void cancel(AwsTimerNode * node);
+    void schedule(AwsTimerNode * node, uint32_t deadline);
+    //moves all nodes with deadline <= now to the list headed by due
+    void advance(uint32_t now, AwsTimerNode * due);
+};
 
 class AsyncWebSocketMessageBuffer {
   private:
@@ -101,14 +168,25 @@ class AsyncWebSocketMessage {
   protected:
     uint8_t _opcode;
     bool _mask;
+    bool _compressed;
+    uint32_t _key;
     AwsMessageStatus _status;
   public:
-    AsyncWebSocketMessage():_opcode(WS_TEXT),_mask(false),_status(WS_MSG_ERROR){}
+    AsyncWebSocketMessage():_opcode(WS_TEXT),_mask(false),_compressed(false),_key(0),_status(WS_MSG_ERROR){}
     virtual ~AsyncWebSocketMessage(){}
     virtual void ack(size_t len __attribute__((unused)), uint32_t time __attribute__((unused))){}
     virtual size_t send(AsyncClient *client __attribute__((unused))){ return 0; }
     virtual bool finished(){ return _status != WS_MSG_SENDING; }
     virtual bool betweenFrames() const { return false; }
+    //payload bytes counted against the queue budget of a client
+    virtual size_t length() const { return 0; }
+    //true once any part of the message was handed to the socket
+    virtual bool started() const { return false; }
+    //compress the payload with permessage-deflate right before the first frame goes out
+    virtual bool deflate(AsyncWebDeflater *deflater __attribute__((unused))){ return false; }
+    //coalescing key, a queued message is replaced by a newer one with the same key (0 = never)
+    void key(uint32_t k){ _key = k; }
+    uint32_t key() const { return _key; }
 };
 
 class AsyncWebSocketBasicMessage: public AsyncWebSocketMessage {
@@ -118,13 +196,24 @@ class AsyncWebSocketBasicMessage: public AsyncWebSocketMessage {
     size_t _ack;
     size_t _acked;
     uint8_t * _data;
+    String _string;
 public:
     AsyncWebSocketBasicMessage(const char * data, size_t len, uint8_t opcode=WS_TEXT, bool mask=false);
     AsyncWebSocketBasicMessage(uint8_t opcode=WS_TEXT, bool mask=false);
+    //takes over the storage of the string instead of copying it
+    AsyncWebSocketBasicMessage(String && data, uint8_t opcode=WS_TEXT, bool mask=false);
     virtual ~AsyncWebSocketBasicMessage() override;
     virtual bool betweenFrames() const override { return _acked == _ack; }
     virtual void ack(size_t len, uint32_t time) override ;
     virtual size_t send(AsyncClient *client) override ;
+    virtual size_t length() const override { return _len; }
+    //once compressed the message is part of the peer's window, even before its first byte went out
+    virtual bool started() const override { return _sent != 0 || _compressed; }
+    //keeps the payload as is if it would not shrink
+    virtual bool deflate(AsyncWebDeflater *deflater) override;
+    //allocates an empty payload of size bytes to be filled through data() before queueing
+    bool reserve(size_t size);
+    uint8_t * data(){ return _data; }
 };
 
 class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage {
@@ -136,14 +225,17 @@ class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage {
     size_t _acked;
     AsyncWebSocketMessageBuffer * _WSbuffer; 
 public:
-    AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode=WS_TEXT, bool mask=false); 
+    AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode=WS_TEXT, bool mask=false, bool compressed=false); 
     virtual ~AsyncWebSocketMultiMessage() override;
     virtual bool betweenFrames() const override { return _acked == _ack; }
     virtual void ack(size_t len, uint32_t time) override ;
     virtual size_t send(AsyncClient *client) override ;
+    virtual size_t length() const override { return _len; }
+    virtual bool started() const override { return _sent != 0; }
 };
 
 class AsyncWebSocketClient {
+  friend AsyncWebSocket;
   private:
     AsyncClient *_client;
     AsyncWebSocket *_server;
@@ -158,15 +250,46 @@ class AsyncWebSocketClient {
 
     uint32_t _lastMessageTime;
     uint32_t _keepAlivePeriod;
+    uint32_t _pongTimeout;
+    uint8_t _maxMissedPongs;
+    uint8_t _missedPongs;
+    bool _awaitingPong;
+    AwsTimerNode _timer;
+
+    size_t _queuedBytes;
+    size_t _queuedMessages;
+    size_t _peakQueuedBytes;
+    uint32_t _droppedMessages;
+    size_t _maxQueuedBytes;
+    size_t _maxQueuedMessages;
+    AwsQueuePolicy _queuePolicy;
+
+    AsyncWebDeflater * _deflater;
+    AsyncWebInflater * _inflater;
+    uint8_t * _rxBuffer;
+    size_t _rxLen;
+    size_t _rxLimit;
+    bool _rxCompressed;
+    bool _rxDiscard;        //the rest of the current message is dropped until its last frame
+    uint8_t _rxOpcode;
 
     void _queueMessage(AsyncWebSocketMessage *dataMessage);
     void _queueControl(AsyncWebSocketControl *controlMessage);
     void _runQueue();
+    bool _queueFits(size_t len) const;
+    void _dropMessage(AsyncWebSocketMessage *dataMessage);
+    bool _dropOldest();
+    AsyncWebSocketMessage * _newMessage(const char * message, size_t len, uint8_t opcode, uint32_t key=0);
+    AsyncWebSocketMessage * _newMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key=0);
+    AsyncWebSocketMessage * _prepareMessage(AsyncWebSocketBasicMessage * message, uint32_t key=0);
+    size_t _printf(bool progmem, const char * format, va_list arg);
+    void _onCompressedData(uint8_t *data, size_t len, bool last);
+    void _onKeepAlive();
 
   public:
     void *_tempObject;
 
-    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server);
+    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server, const AwsDeflateParams *deflate=NULL);
     ~AsyncWebSocketClient();
 
     //client id increments for the given server
@@ -175,6 +298,8 @@ class AsyncWebSocketClient {
     AsyncClient* client(){ return _client; }
     AsyncWebSocket *server(){ return _server; }
     AwsFrameInfo const &pinfo() const { return _pinfo; }
+    //true if permessage-deflate was negotiated with this client
+    bool compressed() const { return _deflater != NULL; }
 
     IPAddress remoteIP();
     uint16_t  remotePort();
@@ -184,19 +309,42 @@ class AsyncWebSocketClient {
     void ping(uint8_t *data=NULL, size_t len=0);
 
     //set auto-ping period in seconds. disabled if zero (default)
-    void keepAlivePeriod(uint16_t seconds){
-      _keepAlivePeriod = seconds * 1000;
-    }
+    void keepAlivePeriod(uint16_t seconds);
     uint16_t keepAlivePeriod(){
       return (uint16_t)(_keepAlivePeriod / 1000);
     }
+    //close the client after maxMissed pings got no answer within timeout seconds
+    void pongTimeout(uint16_t seconds, uint8_t maxMissed=WS_MAX_MISSED_PONGS){
+      _pongTimeout = seconds * 1000;
+      _maxMissedPongs = maxMissed;
+    }
+    uint8_t missedPongs() const { return _missedPongs; }
+
+    //send queue budget, the oldest message is always accepted even if it alone exceeds maxBytes
+    void queueLimit(size_t maxBytes, size_t maxMessages=WS_MAX_QUEUED_MESSAGES){
+      _maxQueuedBytes = maxBytes;
+      _maxQueuedMessages = maxMessages;
+    }
+    size_t queueLimit() const { return _maxQueuedBytes; }
+    void queuePolicy(AwsQueuePolicy policy){ _queuePolicy = policy; }
+    AwsQueuePolicy queuePolicy() const { return _queuePolicy; }
+
+    //queue metrics
+    size_t queuedBytes() const { return _queuedBytes; }
+    size_t queuedMessages() const { return _queuedMessages; }
+    size_t peakQueuedBytes() const { return _peakQueuedBytes; }
+    uint32_t droppedMessages() const { return _droppedMessages; }
+
+    //publish/subscribe, see AsyncWebSocket::publish()
+    bool subscribe(const String& topic);
+    bool unsubscribe(const String& topic);
 
     //data packets
     void message(AsyncWebSocketMessage *message){ _queueMessage(message); }
     bool queueIsFull();
 
     size_t printf(const char *format, ...)  __attribute__ ((format (printf, 2, 3)));
-#ifndef ESP32
+#if !defined(ESP32) && !defined(ASYNCWEBSERVER_HOST)
     size_t printf_P(PGM_P formatP, ...)  __attribute__ ((format (printf, 2, 3)));
 #endif
     void text(const char * message, size_t len);
@@ -204,18 +352,23 @@ class AsyncWebSocketClient {
     void text(uint8_t * message, size_t len);
     void text(char * message);
     void text(const String &message);
+    void text(String &&message);
     void text(const __FlashStringHelper *data);
     void text(AsyncWebSocketMessageBuffer *buffer); 
+    //keyed messages replace a queued message with the same key under WS_QUEUE_COALESCE
+    void text(const char * message, size_t len, uint32_t key);
 
     void binary(const char * message, size_t len);
     void binary(const char * message);
     void binary(uint8_t * message, size_t len);
     void binary(char * message);
     void binary(const String &message);
+    void binary(String &&message);
     void binary(const __FlashStringHelper *data, size_t len);
     void binary(AsyncWebSocketMessageBuffer *buffer); 
+    void binary(const char * message, size_t len, uint32_t key);
 
-    bool canSend() { return _messageQueue.length() < WS_MAX_QUEUED_MESSAGES; }
+    bool canSend() { return _queuedMessages < _maxQueuedMessages && _queuedBytes < _maxQueuedBytes; }
 
     //system callbacks (do not call)
     void _onAck(size_t len, uint32_t time);
@@ -228,14 +381,58 @@ class AsyncWebSocketClient {
 
 typedef std::function<void(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)> AwsEventHandler;
 
+//subscribers of a publish/subscribe topic
+class AsyncWebSocketTopic {
+  private:
+    String _name;
+    std::vector<AsyncWebSocketClient *> _members;
+  public:
+    AsyncWebSocketTopic(const String& name): _name(name) {}
+    const String& name() const { return _name; }
+    const std::vector<AsyncWebSocketClient *>& members() const { return _members; }
+    size_t count() const { return _members.size(); }
+    bool add(AsyncWebSocketClient * client);
+    bool remove(AsyncWebSocketClient * client);
+};
+
+//message handed from an application task to the network task, see AsyncWebSocket::tryTextAll()
+typedef struct {
+    AsyncWebSocketMessageBuffer * buffer;
+    uint8_t opcode;
+    uint32_t key;
+    //stored in the buffer behind the payload, NULL for all clients
+    const char * topic;
+} AwsPublishEntry;
+
 //WebServer Handler implementation that plays the role of a socket server
 class AsyncWebSocket: public AsyncWebHandler {
   private:
     String _url;
     LinkedList<AsyncWebSocketClient *> _clients;
+    std::unordered_map<uint32_t, AsyncWebSocketClient *> _clientIndex;
+    LinkedList<AsyncWebSocketTopic *> _topics;
     uint32_t _cNextId;
     AwsEventHandler _eventHandler;
     bool _enabled;
+    bool _deflateEnabled;
+    AwsDeflateParams _deflateConfig;
+    size_t _deflateLimit;
+    AsyncWebDeflater * _deflater;
+    size_t _maxQueuedBytes;
+    size_t _maxQueuedMessages;
+    AwsQueuePolicy _queuePolicy;
+    uint32_t _droppedMessages;
+    AsyncWebSocketMessageBuffer * _deflateBuffer(AsyncWebSocketMessageBuffer * buffer);
+    void _bufferAll(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key=0, const std::vector<AsyncWebSocketClient *> *members=NULL);
+    size_t _printfAll(bool progmem, const char * format, va_list arg);
+    AsyncWebSocketTimerWheel _timers;
+    uint16_t _keepAlivePeriod;
+    uint16_t _pongTimeout;
+    uint8_t _maxMissedPongs;
+    AsyncWebSocketTopic * _topic(const char * name);
+    void _publish(AsyncWebSocketTopic * topic, AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, uint32_t key);
+    AsyncWebPublishQueue<AwsPublishEntry> _publishQueue;
+    bool _tryPublish(const char * topic, const uint8_t * data, size_t len, uint8_t opcode, uint32_t key);
   public:
     AsyncWebSocket(const String& url);
     ~AsyncWebSocket();
@@ -245,6 +442,42 @@ class AsyncWebSocket: public AsyncWebHandler {
     bool availableForWriteAll();
     bool availableForWrite(uint32_t id);
 
+    //permessage-deflate (RFC 7692) compression, disabled by default
+    void enableDeflate(bool e){ _deflateEnabled = e; }
+    bool deflateEnabled() const { return _deflateEnabled; }
+    //LZ77 window (8..15 bits) for outgoing and incoming messages
+    void deflateWindowBits(uint8_t serverBits, uint8_t clientBits);
+    //keep no compression history between messages (lowers memory, shares broadcast buffers)
+    void deflateNoContextTakeover(bool server, bool client){ _deflateConfig.serverNoContextTakeover = server; _deflateConfig.clientNoContextTakeover = client; }
+    //per client cap (in bytes) for compression windows and compressed messages
+    void deflateMemoryLimit(size_t limit){ _deflateLimit = limit; }
+    size_t deflateMemoryLimit() const { return _deflateLimit; }
+    const AwsDeflateParams &deflateConfig() const { return _deflateConfig; }
+
+    //keep-alive defaults for new clients: ping after period seconds of silence and close the
+    //client after maxMissed pings got no answer within pongTimeout seconds. disabled if zero (default)
+    void keepAlive(uint16_t period, uint16_t pongTimeout=WS_PONG_TIMEOUT, uint8_t maxMissed=WS_MAX_MISSED_PONGS){
+      _keepAlivePeriod = period;
+      _pongTimeout = pongTimeout;
+      _maxMissedPongs = maxMissed;
+    }
+    uint16_t keepAlivePeriod() const { return _keepAlivePeriod; }
+    uint16_t pongTimeout() const { return _pongTimeout; }
+    uint8_t maxMissedPongs() const { return _maxMissedPongs; }
+
+    //send queue defaults for new clients, see AsyncWebSocketClient::queueLimit()
+    void queueLimit(size_t maxBytes, size_t maxMessages=WS_MAX_QUEUED_MESSAGES){
+      _maxQueuedBytes = maxBytes;
+      _maxQueuedMessages = maxMessages;
+    }
+    size_t queueLimit() const { return _maxQueuedBytes; }
+    size_t queueLimitMessages() const { return _maxQueuedMessages; }
+    void queuePolicy(AwsQueuePolicy policy){ _queuePolicy = policy; }
+    AwsQueuePolicy queuePolicy() const { return _queuePolicy; }
+    //bytes waiting in the queues of all clients and messages dropped since start
+    size_t queuedBytes() const;
+    uint32_t droppedMessages() const { return _droppedMessages; }
+
     size_t count() const;
     AsyncWebSocketClient * client(uint32_t id);
     bool hasClient(uint32_t id){ return client(id) != NULL; }
@@ -260,6 +493,7 @@ class AsyncWebSocket: public AsyncWebHandler {
     void text(uint32_t id, uint8_t * message, size_t len);
     void text(uint32_t id, char * message);
     void text(uint32_t id, const String &message);
+    void text(uint32_t id, String &&message);
     void text(uint32_t id, const __FlashStringHelper *message);
 
     void textAll(const char * message, size_t len);
@@ -269,12 +503,15 @@ class AsyncWebSocket: public AsyncWebHandler {
     void textAll(const String &message);
     void textAll(const __FlashStringHelper *message); //  need to convert
     void textAll(AsyncWebSocketMessageBuffer * buffer); 
+    void textAll(const char * message, size_t len, uint32_t key);
+    void textAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key);
 
     void binary(uint32_t id, const char * message, size_t len);
     void binary(uint32_t id, const char * message);
     void binary(uint32_t id, uint8_t * message, size_t len);
     void binary(uint32_t id, char * message);
     void binary(uint32_t id, const String &message);
+    void binary(uint32_t id, String &&message);
     void binary(uint32_t id, const __FlashStringHelper *message, size_t len);
 
     void binaryAll(const char * message, size_t len);
@@ -284,13 +521,36 @@ class AsyncWebSocket: public AsyncWebHandler {
     void binaryAll(const String &message);
     void binaryAll(const __FlashStringHelper *message, size_t len);
     void binaryAll(AsyncWebSocketMessageBuffer * buffer); 
+    void binaryAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key);
 
     void message(uint32_t id, AsyncWebSocketMessage *message);
     void messageAll(AsyncWebSocketMultiMessage *message);
 
+    //publish/subscribe. the payload is placed in one shared buffer for all subscribers of a topic
+    bool subscribe(uint32_t id, const String& topic);
+    bool unsubscribe(uint32_t id, const String& topic);
+    void unsubscribeAll(uint32_t id);
+    size_t subscribers(const String& topic);
+    void publish(const String& topic, AsyncWebSocketMessageBuffer * buffer, uint8_t opcode=WS_TEXT, uint32_t key=0);
+    void publish(const String& topic, const char * message, size_t len, uint8_t opcode=WS_TEXT, uint32_t key=0);
+    void publish(const String& topic, const String& message);
+
+    //safe to call from any task or core. the message is copied into a bounded queue that the
+    //network task drains on its next poll or ack. false if the queue is full (nothing is sent).
+    //without clients there is nobody to send to, the message is dropped and true returned
+    bool tryTextAll(const char * message, size_t len, uint32_t key=0);
+    bool tryTextAll(const String& message, uint32_t key=0){ return tryTextAll(message.c_str(), message.length(), key); }
+    bool tryBinaryAll(const uint8_t * message, size_t len, uint32_t key=0);
+    bool tryPublish(const String& topic, const char * message, size_t len, uint8_t opcode=WS_TEXT, uint32_t key=0);
+    bool tryPublish(const String& topic, const String& message){ return tryPublish(topic, message.c_str(), message.length()); }
+    size_t publishQueueLength() const { return _publishQueue.length(); }
+    size_t publishQueueCapacity() const { return _publishQueue.capacity(); }
+    //messages refused because the queue was full
+    uint32_t publishRejected() const { return _publishQueue.rejected(); }
+
     size_t printf(uint32_t id, const char *format, ...)  __attribute__ ((format (printf, 3, 4)));
     size_t printfAll(const char *format, ...)  __attribute__ ((format (printf, 2, 3)));
-#ifndef ESP32
+#if !defined(ESP32) && !defined(ASYNCWEBSERVER_HOST)
     size_t printf_P(uint32_t id, PGM_P formatP, ...)  __attribute__ ((format (printf, 3, 4)));
 #endif
     size_t printfAll_P(PGM_P formatP, ...)  __attribute__ ((format (printf, 2, 3)));
@@ -305,6 +565,10 @@ class AsyncWebSocket: public AsyncWebHandler {
     void _addClient(AsyncWebSocketClient * client);
     void _handleDisconnect(AsyncWebSocketClient * client);
     void _handleEvent(AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
+    void _handleDrop(){ _droppedMessages++; AWS_METRIC(wsDropped.inc()); }
+    void _scheduleTimer(AsyncWebSocketClient * client, uint32_t deadline){ _timers.schedule(&client->_timer, deadline); }
+    void _runTimers();
+    void _drainPublishQueue();
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 
@@ -321,8 +585,10 @@ class AsyncWebSocketResponse: public AsyncWebServerResponse {
   private:
     String _content;
     AsyncWebSocket *_server;
+    bool _deflate;
+    AwsDeflateParams _deflateParams;
   public:
-    AsyncWebSocketResponse(const String& key, AsyncWebSocket *server);
+    AsyncWebSocketResponse(const String& key, AsyncWebSocket *server, const AwsDeflateParams *deflate=NULL);
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return true; }
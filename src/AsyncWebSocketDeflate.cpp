@@ -0,0 +1,127 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Arduino.h"
+#include "AsyncWebSocketDeflate.h"
+
+/*
+ * Extension negotiation
+ */
+
+static bool parseWindowBits(const String& value, uint8_t &bits){
+  String v = value;
+  v.trim();
+  if(v.startsWith("\"") && v.endsWith("\""))
+    v = v.substring(1, v.length() - 1);
+  long b = v.toInt();
+  if(b < 8 || b > 15)
+    return false;
+  bits = (uint8_t)b;
+  return true;
+}
+
+static bool parseDeflateOffer(const String& offer, const AwsDeflateParams& config, size_t memoryLimit, AwsDeflateParams& result){
+  int semi = offer.indexOf(';');
+  String name = (semi < 0) ? offer : offer.substring(0, semi);
+  name.trim();
+  if(!name.equalsIgnoreCase("permessage-deflate"))
+    return false;
+
+  result = config;
+  bool clientBitsOffered = false;
+  String params = (semi < 0) ? String() : offer.substring(semi + 1);
+  while(params.length()){
+    semi = params.indexOf(';');
+    String param = (semi < 0) ? params : params.substring(0, semi);
+    params = (semi < 0) ? String() : params.substring(semi + 1);
+    param.trim();
+    if(!param.length())
+      continue;
+    int eq = param.indexOf('=');
+    String key = (eq < 0) ? param : param.substring(0, eq);
+    String value = (eq < 0) ? String() : param.substring(eq + 1);
+    key.trim();
+    if(key.equalsIgnoreCase("server_no_context_takeover")){
+      result.serverNoContextTakeover = true;
+    } else if(key.equalsIgnoreCase("client_no_context_takeover")){
+      result.clientNoContextTakeover = true;
+    } else if(key.equalsIgnoreCase("server_max_window_bits")){
+      uint8_t bits;
+      if(!parseWindowBits(value, bits))
+        return false;
+      if(bits < result.serverMaxWindowBits)
+        result.serverMaxWindowBits = bits;
+    } else if(key.equalsIgnoreCase("client_max_window_bits")){
+      clientBitsOffered = true;
+      uint8_t bits;
+      if(eq >= 0){
+        if(!parseWindowBits(value, bits))
+          return false;
+        if(bits < result.clientMaxWindowBits)
+          result.clientMaxWindowBits = bits;
+      }
+    } else {
+      //unknown parameter, the offer has to be declined
+      return false;
+    }
+  }
+  //a client that does not announce client_max_window_bits will use a 32KB window
+  if(!clientBitsOffered)
+    result.clientMaxWindowBits = 15;
+
+  //keep the history windows within the per client memory budget
+  size_t windows = 0;
+  if(!result.serverNoContextTakeover)
+    windows += (size_t)1 << result.serverMaxWindowBits;
+  if(!result.clientNoContextTakeover)
+    windows += (size_t)1 << result.clientMaxWindowBits;
+  if(windows > memoryLimit / 2){
+    result.serverNoContextTakeover = true;
+    result.clientNoContextTakeover = true;
+  }
+  return true;
+}
+
+bool webSocketNegotiateDeflate(const String& offer, const AwsDeflateParams& config, size_t memoryLimit, AwsDeflateParams& result, String& response){
+  String offers = offer;
+  while(offers.length()){
+    int comma = offers.indexOf(',');
+    String current = (comma < 0) ? offers : offers.substring(0, comma);
+    offers = (comma < 0) ? String() : offers.substring(comma + 1);
+    if(!parseDeflateOffer(current, config, memoryLimit, result))
+      continue;
+
+    response = F("permessage-deflate");
+    if(result.serverNoContextTakeover)
+      response += F("; server_no_context_takeover");
+    if(result.clientNoContextTakeover)
+      response += F("; client_no_context_takeover");
+    if(current.indexOf("server_max_window_bits") >= 0){
+      response += F("; server_max_window_bits=");
+      response += String(result.serverMaxWindowBits);
+    }
+    if(current.indexOf("client_max_window_bits") >= 0 && result.clientMaxWindowBits < 15){
+      response += F("; client_max_window_bits=");
+      response += String(result.clientMaxWindowBits);
+    }
+    return true;
+  }
+  return false;
+}
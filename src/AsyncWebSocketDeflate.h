@@ -0,0 +1,53 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSOCKETDEFLATE_H_
+#define ASYNCWEBSOCKETDEFLATE_H_
+
+#include <Arduino.h>
+#include "AsyncWebDeflate.h"
+
+//messages shorter than this are always sent uncompressed
+#ifndef WS_DEFLATE_MIN_SIZE
+#define WS_DEFLATE_MIN_SIZE 32
+#endif
+
+//default per client memory cap for compression windows and compressed/inflated message buffers
+#ifndef WS_DEFLATE_MEMORY_LIMIT
+#define WS_DEFLATE_MEMORY_LIMIT 16384
+#endif
+
+//permessage-deflate (RFC 7692) extension parameters
+typedef struct {
+    /** LZ77 window used for messages sent by the server (8..15) */
+    uint8_t serverMaxWindowBits;
+    /** LZ77 window the client may use for the messages it sends (8..15) */
+    uint8_t clientMaxWindowBits;
+    /** Server compresses every message on its own (no history kept between messages) */
+    bool serverNoContextTakeover;
+    /** Client compresses every message on its own (no history kept between messages) */
+    bool clientNoContextTakeover;
+} AwsDeflateParams;
+
+//negotiates the Sec-WebSocket-Extensions offer of a client against the server configuration.
+//returns false if no acceptable permessage-deflate offer was found.
+bool webSocketNegotiateDeflate(const String& offer, const AwsDeflateParams& config, size_t memoryLimit, AwsDeflateParams& result, String& response);
+
+#endif /* ASYNCWEBSOCKETDEFLATE_H_ */
@@ -0,0 +1,129 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSYNCHRONIZATION_H_
+#define ASYNCWEBSYNCHRONIZATION_H_
+
+#include <Arduino.h>
+
+#ifdef ESP32
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+//mutex that the owning task may take again without blocking itself.
+//lock() returns false if the calling task already holds it, only the outermost caller unlocks
+class AsyncWebLock {
+  private:
+    SemaphoreHandle_t _lock;
+    mutable TaskHandle_t _lockedBy;
+  public:
+    AsyncWebLock(): _lockedBy(NULL) {
+      _lock = xSemaphoreCreateMutex();
+    }
+    ~AsyncWebLock(){
+      vSemaphoreDelete(_lock);
+    }
+    bool lock() const {
+      TaskHandle_t self = xTaskGetCurrentTaskHandle();
+      if(_lockedBy == self)
+        return false;
+      xSemaphoreTake(_lock, portMAX_DELAY);
+      _lockedBy = self;
+      return true;
+    }
+    //takes it only if no task, the caller included, holds it. true if the caller has to unlock
+    bool tryLock() const {
+      TaskHandle_t self = xTaskGetCurrentTaskHandle();
+      if(_lockedBy == self || xSemaphoreTake(_lock, 0) != pdTRUE)
+        return false;
+      _lockedBy = self;
+      return true;
+    }
+    void unlock() const {
+      _lockedBy = NULL;
+      xSemaphoreGive(_lock);
+    }
+};
+
+#elif defined(ASYNCWEBSERVER_HOST)
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//the host TCP layer runs its callbacks on an event loop thread, other threads may publish meanwhile
+class AsyncWebLock {
+  private:
+    mutable std::mutex _lock;
+    mutable std::atomic<std::thread::id> _lockedBy;
+  public:
+    AsyncWebLock(): _lockedBy(std::thread::id()) {}
+    ~AsyncWebLock() {}
+    bool lock() const {
+      std::thread::id self = std::this_thread::get_id();
+      if(_lockedBy.load() == self)
+        return false;
+      _lock.lock();
+      _lockedBy = self;
+      return true;
+    }
+    bool tryLock() const {
+      std::thread::id self = std::this_thread::get_id();
+      if(_lockedBy.load() == self || !_lock.try_lock())
+        return false;
+      _lockedBy = self;
+      return true;
+    }
+    void unlock() const {
+      _lockedBy = std::thread::id();
+      _lock.unlock();
+    }
+};
+
+#else
+
+//ESP8266 runs the network stack and the sketch in one context, nothing to guard
+class AsyncWebLock {
+  public:
+    AsyncWebLock() {}
+    ~AsyncWebLock() {}
+    bool lock() const { return false; }
+    bool tryLock() const { return true; }
+    void unlock() const {}
+};
+
+#endif
+
+class AsyncWebLockGuard {
+  private:
+    const AsyncWebLock *_lock;
+  public:
+    AsyncWebLockGuard(const AsyncWebLock &l){
+      _lock = l.lock() ? &l : NULL;
+    }
+    ~AsyncWebLockGuard(){
+      if(_lock != NULL)
+        _lock->unlock();
+    }
+};
+
+#endif /* ASYNCWEBSYNCHRONIZATION_H_ */
@@ -0,0 +1,324 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebResponseImpl.h"
+
+//bytes read from the source at once while compiling or streaming literals
+#define TEMPLATE_READ_CHUNK 128
+
+static LinkedList<AsyncWebTemplate *> templateCache([](AsyncWebTemplate *t){ t->release(); });
+
+/*
+ * Template
+ * */
+
+AsyncWebTemplate::AsyncWebTemplate(FS &fs, const String& path, const char * const * names, uint16_t count)
+  : _fs(&fs)
+  , _path(path)
+  , _data(NULL)
+  , _size(0)
+  , _lastWrite(0)
+  , _names(names)
+  , _count(count)
+  , _refs(1)
+  , _literalLength(0)
+{
+  _compile();
+}
+
+AsyncWebTemplate::AsyncWebTemplate(const uint8_t * content, size_t len, const char * const * names, uint16_t count)
+  : _fs(NULL)
+  , _path()
+  , _data(content)
+  , _size(len)
+  , _lastWrite(0)
+  , _names(names)
+  , _count(count)
+  , _refs(1)
+  , _literalLength(0)
+{
+  _compile();
+}
+
+void AsyncWebTemplate::_literal(size_t offset, size_t len){
+  if(!len)
+    return;
+  _literalLength += len;
+  if(!_segments.empty()){
+    AwsTemplateSegment& last = _segments.back();
+    if(last.id == AWS_TEMPLATE_LITERAL && last.offset + last.length == offset){
+      last.length += len;
+      return;
+    }
+  }
+  _segments.push_back({ (uint32_t)offset, (uint32_t)len, AWS_TEMPLATE_LITERAL });
+}
+
+uint16_t AsyncWebTemplate::_lookup(){
+  _name[_nameLen] = 0;
+  for(uint16_t i = 0; i < _count; i++){
+    if(strcmp_P(_name, _names[i]) == 0)
+      return i;
+  }
+  return AWS_TEMPLATE_LITERAL;
+}
+
+void AsyncWebTemplate::_scan(const uint8_t * data, size_t len, size_t base){
+  for(size_t i = 0; i < len; i++){
+    size_t pos = base + i;
+    if(data[i] != TEMPLATE_PLACEHOLDER){
+      if(!_inName)
+        continue;
+      if(_nameLen == TEMPLATE_PARAM_NAME_LENGTH)
+        _inName = false; //too long for a name, it was text
+      else
+        _name[_nameLen++] = data[i];
+      continue;
+    }
+    if(!_inName){
+      _inName = true;
+      _open = pos;
+      _nameLen = 0;
+      continue;
+    }
+    if(_nameLen == 0){
+      //%% is a single %
+      _literal(_litStart, _open + 1 - _litStart);
+      _litStart = pos + 1;
+      _inName = false;
+      continue;
+    }
+    uint16_t id = _lookup();
+    if(id == AWS_TEMPLATE_LITERAL){
+      //not a name we know, the closing marker may open the next one
+      _open = pos;
+      _nameLen = 0;
+      continue;
+    }
+    _literal(_litStart, _open - _litStart);
+    _segments.push_back({ (uint32_t)_open, (uint32_t)(pos + 1 - _open), id });
+    _litStart = pos + 1;
+    _inName = false;
+  }
+}
+
+void AsyncWebTemplate::_compile(){
+  _segments.clear();
+  _literalLength = 0;
+  _nameLen = 0;
+  _open = 0;
+  _litStart = 0;
+  _inName = false;
+
+  uint8_t buf[TEMPLATE_READ_CHUNK];
+  if(_fs == NULL){
+    for(size_t pos = 0; pos < _size; ){
+      size_t n = std::min((size_t)TEMPLATE_READ_CHUNK, _size - pos);
+      memcpy_P(buf, _data + pos, n);
+      _scan(buf, n, pos);
+      pos += n;
+    }
+  } else {
+    File f = _fs->open(_path, "r");
+    if(!f || f.isDirectory()){
+      _fs = NULL;
+      return;
+    }
+    _size = f.size();
+    _lastWrite = f.getLastWrite();
+    size_t pos = 0;
+    while(pos < _size){
+      size_t n = f.read(buf, std::min((size_t)TEMPLATE_READ_CHUNK, _size - pos));
+      if(!n)
+        break;
+      _scan(buf, n, pos);
+      pos += n;
+    }
+    f.close();
+    if(pos != _size){
+      _fs = NULL;
+      _segments.clear();
+      return;
+    }
+  }
+  _literal(_litStart, _size - _litStart);
+  _segments.shrink_to_fit();
+}
+
+AsyncWebTemplate * AsyncWebTemplate::fromFile(FS &fs, const String& path, const char * const * names, uint16_t count){
+  File f = fs.open(path, "r");
+  if(!f)
+    return NULL;
+  size_t size = f.size();
+  time_t lastWrite = f.getLastWrite();
+  f.close();
+
+  for(AsyncWebTemplate * t: templateCache){
+    if(t->_fs != &fs || t->_path != path || t->_names != names || t->_count != count)
+      continue;
+    if(t->_size == size && t->_lastWrite == lastWrite)
+      return t;
+    templateCache.remove(t);
+    break;
+  }
+
+  AsyncWebTemplate * t = new AsyncWebTemplate(fs, path, names, count);
+  if(t == NULL)
+    return NULL;
+  if(!t->valid()){
+    t->release();
+    return NULL;
+  }
+  if(templateCache.length() >= AWS_TEMPLATE_CACHE_ENTRIES)
+    templateCache.remove(templateCache.front());
+  templateCache.add(t);
+  return t;
+}
+
+void AsyncWebTemplate::clearCache(){
+  templateCache.free();
+}
+
+/*
+ * Response
+ * */
+
+AsyncTemplateResponse::AsyncTemplateResponse(int code, const String& contentType, AsyncWebTemplate * tpl, AwsTemplateValueFunction values, bool knownLength)
+  : _template(tpl)
+  , _values(values)
+  , _segment(0)
+  , _segmentPos(0)
+  , _placeholder(0)
+  , _valueReady(false)
+  , _filePos(0)
+{
+  _code = code;
+  _contentType = contentType;
+  if(_template == NULL)
+    return;
+  _template->retain();
+  if(_template->isFile()){
+    _file = _template->fs()->open(_template->path(), "r");
+    //the file changed since it was compiled, the offsets are no good anymore
+    if(_file && _file.size() != _template->size())
+      _file.close();
+  }
+
+  if(!knownLength || !_values){
+    _sendContentLength = false;
+    _chunked = true;
+    return;
+  }
+  //every value is taken now so that the length is known before the headers
+  _contentLength = _template->literalLength();
+  for(const AwsTemplateSegment& s: _template->segments()){
+    if(s.id == AWS_TEMPLATE_LITERAL)
+      continue;
+    _known.push_back(_values(s.id));
+    if(_known.back() == TEMPLATE_PENDING){
+      //a deferred value, the length can not be known
+      _known.clear();
+      _contentLength = 0;
+      _sendContentLength = false;
+      _chunked = true;
+      return;
+    }
+    _contentLength += _known.back().length();
+  }
+}
+
+AsyncTemplateResponse::~AsyncTemplateResponse(){
+  if(_file)
+    _file.close();
+  if(_template != NULL)
+    _template->release();
+}
+
+void AsyncTemplateResponse::_respond(AsyncWebServerRequest *request){
+  //HTTP/1.0 has no chunks, the end of the body is the end of the connection
+  if(!request->version())
+    _chunked = false;
+  AsyncAbstractResponse::_respond(request);
+}
+
+bool AsyncTemplateResponse::_sourceValid() const {
+  if(_template == NULL || !_template->valid())
+    return false;
+  return !_template->isFile() || !!(_file);
+}
+
+size_t AsyncTemplateResponse::_readLiteral(uint8_t *data, size_t offset, size_t len){
+  if(!_template->isFile()){
+    memcpy_P(data, _template->data() + offset, len);
+    return len;
+  }
+  if(_filePos != offset && !_file.seek(offset))
+    return 0;
+  size_t n = _file.read(data, len);
+  _filePos = offset + n;
+  return n;
+}
+
+size_t AsyncTemplateResponse::_fillBuffer(uint8_t *data, size_t len){
+  const std::vector<AwsTemplateSegment>& segments = _template->segments();
+  size_t written = 0;
+  while(written < len && _segment < segments.size()){
+    const AwsTemplateSegment& s = segments[_segment];
+    size_t end;
+    if(s.id == AWS_TEMPLATE_LITERAL){
+      size_t n = std::min((size_t)s.length - _segmentPos, len - written);
+      n = _readLiteral(data + written, s.offset + _segmentPos, n);
+      if(!n)
+        break;
+      _segmentPos += n;
+      written += n;
+      end = s.length;
+    } else {
+      if(!_valueReady){
+        if(_placeholder < _known.size())
+          _value = std::move(_known[_placeholder]);
+        else if(_values)
+          _value = _values(s.id);
+        if(_value == TEMPLATE_PENDING){
+          //asked again on the next call, what is written so far goes out
+          _value = String();
+          return written ? written : RESPONSE_TRY_AGAIN;
+        }
+        _valueReady = true;
+      }
+      size_t n = std::min((size_t)_value.length() - _segmentPos, len - written);
+      memcpy(data + written, _value.c_str() + _segmentPos, n);
+      _segmentPos += n;
+      written += n;
+      end = _value.length();
+    }
+    if(_segmentPos < end)
+      continue;
+    if(s.id != AWS_TEMPLATE_LITERAL){
+      _placeholder++;
+      _value = String();
+      _valueReady = false;
+    }
+    _segment++;
+    _segmentPos = 0;
+  }
+  return written;
+}
@@ -0,0 +1,125 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBTEMPLATE_H_
+#define ASYNCWEBTEMPLATE_H_
+
+#include <Arduino.h>
+#include <functional>
+#include "FS.h"
+#include "StringArray.h"
+
+#ifdef Arduino_h
+// arduino is not compatible with std::vector
+#undef min
+#undef max
+#endif
+#include <vector>
+
+#ifndef TEMPLATE_PLACEHOLDER
+#define TEMPLATE_PLACEHOLDER '%'
+#endif
+
+#define TEMPLATE_PARAM_NAME_LENGTH 32
+
+//returned by a template processor or value function for a value that is not ready yet.
+//the response stops before the placeholder and asks for it again on the next poll or resume()
+#define TEMPLATE_PENDING "\x01"
+
+//compiled templates kept by AsyncWebTemplate::fromFile
+#ifndef AWS_TEMPLATE_CACHE_ENTRIES
+#define AWS_TEMPLATE_CACHE_ENTRIES 4
+#endif
+
+//id of literal segments
+#define AWS_TEMPLATE_LITERAL 0xFFFF
+
+//value of the placeholder with the given index in the names the template was compiled with
+typedef std::function<String(uint16_t id)> AwsTemplateValueFunction;
+
+//a literal run of the source or one placeholder
+typedef struct {
+  uint32_t offset;  //into the source
+  uint32_t length;  //literal bytes, or the placeholder text with both markers
+  uint16_t id;      //index into the names, AWS_TEMPLATE_LITERAL for literals
+} AwsTemplateSegment;
+
+//a template split once into literal ranges and placeholder ids.
+//literals are not copied, responses stream them from the file or from flash/RAM.
+//%%  is a single %, a %name% that is not in the names stays in the output as it is
+class AsyncWebTemplate {
+  using File = fs::File;
+  using FS = fs::FS;
+  private:
+    FS * _fs;
+    String _path;
+    const uint8_t * _data;
+    size_t _size;
+    time_t _lastWrite;
+    const char * const * _names;
+    uint16_t _count;
+    uint32_t _refs;
+    std::vector<AwsTemplateSegment> _segments;
+    size_t _literalLength;
+    //scanner state, only used while compiling
+    char _name[TEMPLATE_PARAM_NAME_LENGTH + 1];
+    size_t _nameLen;
+    size_t _open;
+    size_t _litStart;
+    bool _inName;
+
+    void _literal(size_t offset, size_t len);
+    void _scan(const uint8_t * data, size_t len, size_t base);
+    uint16_t _lookup();
+    void _compile();
+  public:
+    //names are the known placeholders, the array must outlive the template
+    AsyncWebTemplate(FS &fs, const String& path, const char * const * names, uint16_t count);
+    //content is PROGMEM (or RAM) and must outlive the template
+    AsyncWebTemplate(const uint8_t * content, size_t len, const char * const * names, uint16_t count);
+    ~AsyncWebTemplate(){}
+
+    //compiled template of a file, reused while the file keeps its size and modification time.
+    //the cache owns it, responses take their own reference
+    static AsyncWebTemplate * fromFile(FS &fs, const String& path, const char * const * names, uint16_t count);
+    //drops the compiled files, responses in flight keep theirs
+    static void clearCache();
+
+    bool isFile() const { return _fs != NULL; }
+    FS * fs() const { return _fs; }
+    const String& path() const { return _path; }
+    const uint8_t * data() const { return _data; }
+    size_t size() const { return _size; }
+    time_t lastWrite() const { return _lastWrite; }
+    const char * const * names() const { return _names; }
+    uint16_t count() const { return _count; }
+    //false if the file could not be read
+    bool valid() const { return _data != NULL || _fs != NULL; }
+    const std::vector<AwsTemplateSegment>& segments() const { return _segments; }
+    //bytes of the output that do not come from placeholders
+    size_t literalLength() const { return _literalLength; }
+
+    //templates are shared by their owner and the responses streaming them.
+    //a new template holds the reference of its owner
+    void retain(){ _refs++; }
+    void release(){ if(!_refs || --_refs == 0) delete this; }
+};
+
+#endif /* ASYNCWEBTEMPLATE_H_ */
@@ -0,0 +1,130 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+
+#if ASYNCWEBSERVER_TRACING
+
+//microseconds, accept to the last phase
+static const uint32_t routeBuckets[] = { 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000 };
+
+static const char * traceMethod(uint8_t method){
+  switch(method){
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_PUT: return "PUT";
+    case HTTP_PATCH: return "PATCH";
+    case HTTP_HEAD: return "HEAD";
+    case HTTP_OPTIONS: return "OPTIONS";
+    default: return "UNKNOWN";
+  }
+}
+
+static void traceCopyUrl(char * out, const String& url){
+  size_t len = url.length();
+  if(len > AWS_TRACE_URL_LENGTH - 1)
+    len = AWS_TRACE_URL_LENGTH - 1;
+  memcpy(out, url.c_str(), len);
+  out[len] = 0;
+}
+
+uint32_t AsyncWebRequestTrace::total() const {
+  for(int phase = TRACE_PHASES - 1; phase > TRACE_ACCEPT; phase--){
+    if(marked((AwsTracePhase)phase))
+      return _at[phase];
+  }
+  return 0;
+}
+
+AsyncWebTraceRoute::AsyncWebTraceRoute()
+  : _handler(NULL)
+  , _latency("http_route_microseconds", "Request latency of one handler", routeBuckets, sizeof(routeBuckets) / sizeof(routeBuckets[0]))
+{
+  _url[0] = 0;
+}
+
+void AsyncWebTraceRoute::_assign(AsyncWebHandler * handler, const String& url){
+  _handler = handler;
+  traceCopyUrl(_url, url);
+}
+
+size_t AsyncWebTracer::routes() const {
+  size_t n = 0;
+  while(n < AWS_TRACE_ROUTES && _routes[n].handler() != NULL)
+    n++;
+  return n;
+}
+
+void AsyncWebTracer::_record(const AsyncWebRequestTrace& trace, AsyncWebHandler * handler, uint8_t method, const String& url){
+  //requests that never sent a byte are only connections
+  if(!trace.marked(TRACE_FIRST_BYTE))
+    return;
+  AwsTraceEntry& e = _entries[(_head + _count) % AWS_TRACE_ENTRIES];
+  if(_count < AWS_TRACE_ENTRIES)
+    _count++;
+  else
+    _head = (_head + 1) % AWS_TRACE_ENTRIES;
+  e.trace = trace;
+  e.method = method;
+  traceCopyUrl(e.url, url);
+
+  if(handler == NULL)
+    return;
+  for(size_t i = 0; i < AWS_TRACE_ROUTES; i++){
+    if(_routes[i].handler() == NULL)
+      _routes[i]._assign(handler, url);
+    if(_routes[i].handler() == handler){
+      _routes[i]._observe(trace.total());
+      return;
+    }
+  }
+}
+
+void AsyncWebTracer::dump(Print &out) const {
+  out.print(F("method url: first byte, headers, handler, handler done, first send, last ack, total (us)\n"));
+  for(size_t i = 0; i < _count; i++){
+    const AwsTraceEntry& e = entry(i);
+    out.printf("%s %s:", traceMethod(e.method), e.url);
+    for(int phase = TRACE_FIRST_BYTE; phase < TRACE_PHASES; phase++){
+      if(e.trace.marked((AwsTracePhase)phase))
+        out.printf(" %u", (unsigned)e.trace.at((AwsTracePhase)phase));
+      else
+        out.print(F(" -"));
+    }
+    out.printf(" %u\n", (unsigned)e.trace.total());
+  }
+  out.print(F("route: count, p50, p90, p99 (us)\n"));
+  for(size_t i = 0; i < routes(); i++){
+    const AsyncWebHistogram& h = _routes[i].latency();
+    out.printf("%s: %u", _routes[i].url(), (unsigned)h.count());
+    const uint8_t ps[] = { 50, 90, 99 };
+    for(uint8_t p: ps){
+      uint32_t v = h.percentile(p);
+      if(v == 0xFFFFFFFF)
+        out.print(F(" +Inf"));
+      else
+        out.printf(" <=%u", (unsigned)v);
+    }
+    out.print('\n');
+  }
+}
+
+#endif /* ASYNCWEBSERVER_TRACING */
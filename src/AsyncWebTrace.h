@@ -0,0 +1,139 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBTRACE_H_
+#define ASYNCWEBTRACE_H_
+
+#include <Arduino.h>
+
+//set to 1 to record the phases of every request. when 0 nothing is compiled in
+#ifndef ASYNCWEBSERVER_TRACING
+#define ASYNCWEBSERVER_TRACING 0
+#endif
+
+#if ASYNCWEBSERVER_TRACING
+
+#include "AsyncWebMetrics.h"
+
+//finished requests kept for inspection
+#ifndef AWS_TRACE_ENTRIES
+#define AWS_TRACE_ENTRIES 16
+#endif
+
+//handlers that get their own latency histogram, later ones are not tracked per route
+#ifndef AWS_TRACE_ROUTES
+#define AWS_TRACE_ROUTES 8
+#endif
+
+#define AWS_TRACE_URL_LENGTH 32
+
+#define AWS_TRACE(phase) _trace.mark(phase)
+
+class AsyncWebHandler;
+
+typedef enum {
+  TRACE_ACCEPT,         //connection accepted, the request object exists
+  TRACE_FIRST_BYTE,     //first byte of the request received
+  TRACE_HEADERS,        //end of headers
+  TRACE_HANDLER,        //handler attached
+  TRACE_HANDLER_DONE,   //handleRequest returned
+  TRACE_FIRST_SEND,     //response started writing
+  TRACE_LAST_ACK,       //response acknowledged completely
+  TRACE_PHASES
+} AwsTracePhase;
+
+class AsyncWebRequestTrace {
+  private:
+    uint32_t _start;
+    uint8_t _marked;
+    uint32_t _at[TRACE_PHASES];
+  public:
+    AsyncWebRequestTrace(): _start(micros()), _marked(1) { memset(_at, 0, sizeof(_at)); }
+    //only the first mark of a phase counts
+    void mark(AwsTracePhase phase){
+      if(_marked & (1 << phase))
+        return;
+      _marked |= (1 << phase);
+      _at[phase] = micros() - _start;
+    }
+    bool marked(AwsTracePhase phase) const { return _marked & (1 << phase); }
+    //microseconds from accept to the phase
+    uint32_t at(AwsTracePhase phase) const { return _at[phase]; }
+    //microseconds from accept to the last phase reached
+    uint32_t total() const;
+};
+
+//one finished request
+typedef struct {
+  AsyncWebRequestTrace trace;
+  uint8_t method;
+  char url[AWS_TRACE_URL_LENGTH];
+} AwsTraceEntry;
+
+//latency of the requests served by one handler
+class AsyncWebTraceRoute {
+  private:
+    AsyncWebHandler * _handler;
+    char _url[AWS_TRACE_URL_LENGTH];
+    AsyncWebHistogram _latency;
+  public:
+    AsyncWebTraceRoute();
+    AsyncWebHandler * handler() const { return _handler; }
+    //url of the first request the handler served
+    const char * url() const { return _url; }
+    const AsyncWebHistogram& latency() const { return _latency; }
+    void _assign(AsyncWebHandler * handler, const String& url);
+    void _observe(uint32_t us){ _latency.observe(us); }
+};
+
+class AsyncWebTracer {
+  private:
+    AwsTraceEntry _entries[AWS_TRACE_ENTRIES];
+    size_t _head;
+    size_t _count;
+    AsyncWebTraceRoute _routes[AWS_TRACE_ROUTES];
+    AsyncWebTracer(): _head(0), _count(0) {}
+  public:
+    size_t count() const { return _count; }
+    //0 is the oldest kept request
+    const AwsTraceEntry& entry(size_t i) const { return _entries[(_head + i) % AWS_TRACE_ENTRIES]; }
+    const AsyncWebTraceRoute& route(size_t i) const { return _routes[i]; }
+    size_t routes() const;
+    void clear(){ _head = 0; _count = 0; }
+    //prints the recent requests and the per route percentiles
+    void dump(Print &out) const;
+
+    void _record(const AsyncWebRequestTrace& trace, AsyncWebHandler * handler, uint8_t method, const String& url);
+
+    AsyncWebTracer(AsyncWebTracer const &) = delete;
+    AsyncWebTracer &operator=(AsyncWebTracer const &) = delete;
+    static AsyncWebTracer &Instance() {
+      static AsyncWebTracer instance;
+      return instance;
+    }
+};
+
+#else
+
+#define AWS_TRACE(phase)
+
+#endif /* ASYNCWEBSERVER_TRACING */
+
+#endif /* ASYNCWEBTRACE_H_ */
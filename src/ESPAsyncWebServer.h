@@ -27,6 +27,10 @@
 #include "FS.h"
 
 #include "StringArray.h"
+#include "AsyncWebMetrics.h"
+#include "AsyncWebTrace.h"
+#include "AsyncWebTemplate.h"
+#include "AsyncWebScheduler.h"
 
 #ifdef ESP32
 #include <WiFi.h>
@@ -34,6 +38,10 @@
 #elif defined(ESP8266)
 #include <ESP8266WiFi.h>
 #include <ESPAsyncTCP.h>
+#elif defined(ASYNCWEBSERVER_HOST)
+//host (Linux) build: Arduino.h, FS.h and AsyncTCP.h come from a POSIX compatibility layer
+//that follows the API of the ESP32 core and AsyncTCP
+#include <AsyncTCP.h>
 #else
 #error Platform not supported
 #endif
@@ -50,6 +58,7 @@ class AsyncWebHandler;
 class AsyncStaticWebHandler;
 class AsyncCallbackWebHandler;
 class AsyncResponseStream;
+class AsyncChunkedResponseStream;
 
 #ifndef WEBSERVER_H
 typedef enum {
@@ -123,6 +132,8 @@ class AsyncWebHeader {
 typedef enum { RCT_NOT_USED = -1, RCT_DEFAULT = 0, RCT_HTTP, RCT_WS, RCT_EVENT, RCT_MAX } RequestedConnectionType;
 
 typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+//called by a chunked stream when room bytes can be written
+typedef std::function<void(AsyncChunkedResponseStream *stream, size_t room)> AwsStreamWritableHandler;
 typedef std::function<String(const String&)> AwsTemplateProcessor;
 
 class AsyncWebServerRequest {
@@ -150,11 +161,18 @@ class AsyncWebServerRequest {
     RequestedConnectionType _reqconntype;
     void _removeNotInterestingHeaders();
     bool _isDigest;
+    bool _digestStale;
     bool _isMultipart;
     bool _isPlainPost;
     bool _expectingContinue;
     size_t _contentLength;
     size_t _parsedLength;
+    uint32_t _parseStart;
+#if ASYNCWEBSERVER_TRACING
+    AsyncWebRequestTrace _trace;
+    //set while handleRequest runs, the handler may delete the request
+    bool * _destroyed;
+#endif
 
     LinkedList<AsyncWebHeader *> _headers;
     LinkedList<AsyncWebParameter *> _params;
@@ -171,6 +189,10 @@ class AsyncWebServerRequest {
     size_t _itemBufferIndex;
     bool _itemIsFile;
 
+    uint8_t *_body;
+    size_t _bodyLength;
+    size_t _bodyCapacity;
+
     void _onPoll();
     void _onAck(size_t len, uint32_t time);
     void _onError(int8_t error);
@@ -186,6 +208,7 @@ class AsyncWebServerRequest {
     void _parsePlainPostChar(uint8_t data);
     void _parseMultipartPostByte(uint8_t data, bool last);
     void _addGetParams(const String& params);
+    void _handleRequest();
 
     void _handleUploadStart();
     void _handleUploadByte(uint8_t data, bool last);
@@ -199,6 +222,9 @@ class AsyncWebServerRequest {
     ~AsyncWebServerRequest();
 
     AsyncClient* client(){ return _client; }
+#if ASYNCWEBSERVER_TRACING
+    const AsyncWebRequestTrace& trace() const { return _trace; }
+#endif
     uint8_t version() const { return _version; }
     WebRequestMethodComposite method() const { return _method; }
     const String& url() const { return _url; }
@@ -212,6 +238,13 @@ class AsyncWebServerRequest {
     bool isExpectedRequestedConnType(RequestedConnectionType erct1, RequestedConnectionType erct2 = RCT_NOT_USED, RequestedConnectionType erct3 = RCT_NOT_USED);
     void onDisconnect (ArDisconnectHandler fn);
 
+    //keeps the body of this request, call it from handleBody with its arguments.
+    //returns false if the body is larger than maxLength or there is no memory for it
+    bool bufferBody(const uint8_t *data, size_t len, size_t index, size_t total, size_t maxLength);
+    //the buffered body, NUL terminated. owned by the request, NULL if nothing was buffered
+    const char * body() const { return (const char *)_body; }
+    size_t bodyLength() const { return _bodyLength; }
+
     //hash is the string representation of:
     // base64(user:pass) for basic or
     // user:realm:md5(user:realm:pass) for digest
@@ -225,6 +258,10 @@ class AsyncWebServerRequest {
     void redirect(const String& url);
 
     void send(AsyncWebServerResponse *response);
+    //continues a response waiting for a pending template value. network task only
+    void resume();
+    //runs step on the server scheduler until it returns false or the client disconnects
+    bool schedule(AwsJobFunction step);
     void send(int code, const String& contentType=String(), const String& content=String());
     void send(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
     void send(File content, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
@@ -233,6 +270,7 @@ class AsyncWebServerRequest {
     void sendChunked(const String& contentType, AwsResponseFiller callback, AwsTemplateProcessor templateCallback=nullptr);
     void send_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     void send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    void sendTemplate(AsyncWebTemplate * tpl, const String& contentType, AwsTemplateValueFunction values, bool knownLength=false);
 
     AsyncWebServerResponse *beginResponse(int code, const String& contentType=String(), const String& content=String());
     AsyncWebServerResponse *beginResponse(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
@@ -241,8 +279,10 @@ class AsyncWebServerRequest {
     AsyncWebServerResponse *beginResponse(const String& contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback=nullptr);
     AsyncWebServerResponse *beginChunkedResponse(const String& contentType, AwsResponseFiller callback, AwsTemplateProcessor templateCallback=nullptr);
     AsyncResponseStream *beginResponseStream(const String& contentType, size_t bufferSize=1460);
+    AsyncChunkedResponseStream *beginChunkedResponseStream(const String& contentType, size_t bufferSize=1460, AwsStreamWritableHandler onWritable=nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    AsyncWebServerResponse *beginTemplateResponse(AsyncWebTemplate * tpl, const String& contentType, AwsTemplateValueFunction values, bool knownLength=false);
 
     size_t headers() const;                     // get header count
     bool hasHeader(const String& name) const;   // check if header exists
@@ -389,6 +429,7 @@ class AsyncWebServer {
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
+    AsyncWebScheduler _scheduler;
 
   public:
     AsyncWebServer(uint16_t port);
@@ -421,6 +462,9 @@ class AsyncWebServer {
     void onRequestBody(ArBodyHandlerFunction fn); //handle posts with plain body content (JSON often transmitted this way as a request)
 
     void reset(); //remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody 
+
+    //jobs of all requests, run from the polls of the connections
+    AsyncWebScheduler& scheduler(){ return _scheduler; }
   
     void _handleDisconnect(AsyncWebServerRequest *request);
     void _attachHandler(AsyncWebServerRequest *request);
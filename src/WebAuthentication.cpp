@@ -20,11 +20,15 @@
 */
 #include "WebAuthentication.h"
 #include <libb64/cencode.h>
-#ifdef ESP32
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
 #include "mbedtls/md5.h"
+#include "mbedtls/version.h"
 #else
 #include "md5.h"
 #endif
+#ifdef ASYNCWEBSERVER_HOST
+#include <unistd.h>
+#endif
 
 
 // Basic Auth hash = base64("username:password")
@@ -58,55 +62,83 @@ bool checkBasicAuthentication(const char * hash, const char * username, const ch
   return false;
 }
 
-static bool getMD5(uint8_t * data, uint16_t len, char * output){//33 bytes or more
-#ifdef ESP32
-    mbedtls_md5_context _ctx;
+typedef struct {
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  mbedtls_md5_context ctx;
 #else
-    md5_context_t _ctx;
+  md5_context_t ctx;
 #endif
-  uint8_t i;
-  uint8_t * _buf = (uint8_t*)malloc(16);
-  if(_buf == NULL)
-    return false;
-  memset(_buf, 0x00, 16);
-#ifdef ESP32
-  mbedtls_md5_init(&_ctx);
-  //mbedtls_md5_starts(&_ctx);
-  mbedtls_md5_update(&_ctx, data, len);
-  mbedtls_md5_finish(&_ctx, _buf);
+} DigestMD5;
+
+static void md5Begin(DigestMD5 * md5){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  mbedtls_md5_init(&md5->ctx);
+//mbedtls 2.7 up to 3.0 deprecates the plain names in favour of the _ret ones
+#if MBEDTLS_VERSION_NUMBER >= 0x02070000 && MBEDTLS_VERSION_NUMBER < 0x03000000
+  mbedtls_md5_starts_ret(&md5->ctx);
+#else
+  mbedtls_md5_starts(&md5->ctx);
+#endif
+#else
+  MD5Init(&md5->ctx);
+#endif
+}
+
+static void md5Add(DigestMD5 * md5, const void * data, size_t len){
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  mbedtls_md5_update(&md5->ctx, (const uint8_t *)data, len);
+#else
+  MD5Update(&md5->ctx, (const uint8_t *)data, len);
+#endif
+}
+
+static void md5Add(DigestMD5 * md5, const char * str){
+  md5Add(md5, str, strlen(str));
+}
+
+static void md5Hex(DigestMD5 * md5, char * output){//33 bytes or more
+  static const char hex[] = "0123456789abcdef";
+  uint8_t buf[16];
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
+  mbedtls_md5_finish(&md5->ctx, buf);
+  mbedtls_md5_free(&md5->ctx);
 #else
-  MD5Init(&_ctx);
-  MD5Update(&_ctx, data, len);
-  MD5Final(_buf, &_ctx);
+  MD5Final(buf, &md5->ctx);
 #endif
-  for(i = 0; i < 16; i++) {
-    sprintf(output + (i * 2), "%02x", _buf[i]);
+  for(uint8_t i = 0; i < 16; i++){
+    output[i * 2] = hex[buf[i] >> 4];
+    output[i * 2 + 1] = hex[buf[i] & 0x0F];
   }
-  free(_buf);
+  output[32] = 0;
+}
+
+static bool getMD5(uint8_t * data, uint16_t len, char * output){//33 bytes or more
+  DigestMD5 md5;
+  md5Begin(&md5);
+  md5Add(&md5, data, len);
+  md5Hex(&md5, output);
   return true;
 }
 
-static String genRandomMD5(){
-#ifdef ESP8266
-  uint32_t r = RANDOM_REG32;
+static uint32_t digestRandom(){
+#if defined(ESP8266)
+  return RANDOM_REG32;
+#elif defined(ESP32)
+  return esp_random();
 #else
-  uint32_t r = rand();
+  //nonces must not be predictable, a host takes them from the kernel
+  uint32_t r;
+  if(getentropy(&r, sizeof(r)) != 0)
+    abort();
+  return r;
 #endif
-  char * out = (char*)malloc(33);
-  if(out == NULL || !getMD5((uint8_t*)(&r), 4, out))
-    return "";
-  String res = String(out);
-  free(out);
-  return res;
 }
 
-static String stringMD5(const String& in){
-  char * out = (char*)malloc(33);
-  if(out == NULL || !getMD5((uint8_t*)(in.c_str()), in.length(), out))
-    return "";
-  String res = String(out);
-  free(out);
-  return res;
+//32 hex digits of fresh randomness
+static void genRandomHex(char * out){
+  for(uint8_t i = 0; i < 4; i++)
+    sprintf(out + i * 8, "%08x", (unsigned)digestRandom());
+  out[32] = 0;
 }
 
 String generateDigestHash(const char * username, const char * password, const char * realm){
@@ -127,109 +159,293 @@ String generateDigestHash(const char * username, const char * password, const ch
   return res;
 }
 
-String requestDigestAuthentication(const char * realm){
+/*
+ * Nonces handed out with the challenges. a nonce is good for AWS_DIGEST_NONCE_LIFETIME
+ * and every nonce count (nc) of it is accepted once
+ * */
+
+typedef struct {
+  char nonce[33];
+  char opaque[33];
+  uint32_t issued;
+  uint32_t nc;      //highest nonce count seen
+  uint32_t seen;    //bit n is set if nc - n was used
+} DigestNonce;
+
+static DigestNonce digestNonces[AWS_DIGEST_NONCES];
+
+static bool digestNonceExpired(const DigestNonce& n, uint32_t now){
+  return !n.nonce[0] || (now - n.issued) > AWS_DIGEST_NONCE_LIFETIME;
+}
+
+static DigestNonce * digestNonceIssue(){
+  uint32_t now = millis();
+  DigestNonce * slot = &digestNonces[0];
+  for(size_t i = 0; i < AWS_DIGEST_NONCES; i++){
+    DigestNonce& n = digestNonces[i];
+    if(digestNonceExpired(n, now)){
+      slot = &n;
+      break;
+    }
+    //all in use, the oldest goes
+    if(now - n.issued > now - slot->issued)
+      slot = &n;
+  }
+  genRandomHex(slot->nonce);
+  genRandomHex(slot->opaque);
+  slot->issued = now;
+  slot->nc = 0;
+  slot->seen = 0;
+  return slot;
+}
+
+//false if nc of the nonce was used already or is too far behind the highest one
+static bool digestNonceFresh(const DigestNonce& n, uint32_t nc){
+  if(nc > n.nc)
+    return true;
+  uint32_t behind = n.nc - nc;
+  return behind < 32 && !(n.seen & (1UL << behind));
+}
+
+static void digestNonceUse(DigestNonce& n, uint32_t nc){
+  if(nc > n.nc){
+    uint32_t ahead = nc - n.nc;
+    n.seen = (ahead < 32) ? (n.seen << ahead) : 0;
+    n.nc = nc;
+  }
+  n.seen |= 1UL << (n.nc - nc);
+}
+
+String requestDigestAuthentication(const char * realm, bool stale){
+  DigestNonce * n = digestNonceIssue();
   String header = F("realm=\"");
   if(realm == NULL)
     header.concat(F("asyncesp"));
   else
     header.concat(realm);
   header.concat( "\", qop=\"auth\", nonce=\"");
-  header.concat(genRandomMD5());
+  header.concat(n->nonce);
   header.concat("\", opaque=\"");
-  header.concat(genRandomMD5());
+  header.concat(n->opaque);
   header.concat("\"");
+  if(stale)
+    header.concat(", stale=TRUE");
   return header;
 }
 
-bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri){
+/*
+ * HA1 = md5(username:realm:password) of recent users, keyed by a hash of the three
+ * */
+
+typedef struct {
+  uint64_t key;
+  char ha1[33];
+} DigestHA1;
+
+static DigestHA1 digestHA1Cache[AWS_DIGEST_HA1_CACHE];
+static size_t digestHA1Next = 0;
+
+static uint64_t fnv1a(uint64_t h, const char * data, size_t len){
+  for(size_t i = 0; i < len; i++){
+    h ^= (uint8_t)data[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static const char * digestHA1(const char * username, const char * realm, size_t realmLen, const char * password){
+  uint64_t key = fnv1a(0xcbf29ce484222325ULL, username, strlen(username) + 1);
+  key = fnv1a(key, realm, realmLen);
+  key = fnv1a(key, ":", 1);
+  key = fnv1a(key, password, strlen(password));
+  if(key == 0)
+    key = 1;
+  for(size_t i = 0; i < AWS_DIGEST_HA1_CACHE; i++){
+    if(digestHA1Cache[i].key == key)
+      return digestHA1Cache[i].ha1;
+  }
+  DigestHA1& e = digestHA1Cache[digestHA1Next];
+  digestHA1Next = (digestHA1Next + 1) % AWS_DIGEST_HA1_CACHE;
+  DigestMD5 md5;
+  md5Begin(&md5);
+  md5Add(&md5, username);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, realm, realmLen);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, password);
+  md5Hex(&md5, e.ha1);
+  e.key = key;
+  return e.ha1;
+}
+
+/*
+ * Authorization header
+ * */
+
+enum { DIGEST_USERNAME, DIGEST_REALM, DIGEST_NONCE, DIGEST_URI, DIGEST_RESPONSE, DIGEST_QOP, DIGEST_NC, DIGEST_CNONCE, DIGEST_OPAQUE, DIGEST_FIELDS };
+
+static const char * const digestFieldNames[DIGEST_FIELDS] = { "username", "realm", "nonce", "uri", "response", "qop", "nc", "cnonce", "opaque" };
+
+typedef struct {
+  const char * value;
+  size_t len;
+} DigestField;
+
+//splits name=value, name="value" pairs in place, values point into the header
+static bool parseDigestHeader(const char * p, DigestField * fields){
+  memset(fields, 0, sizeof(DigestField) * DIGEST_FIELDS);
+  for(;;){
+    while(*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    if(!*p)
+      return true;
+    const char * name = p;
+    while(*p && *p != '=' && *p != ' ' && *p != ',')
+      p++;
+    size_t nameLen = p - name;
+    while(*p == ' ')
+      p++;
+    if(*p++ != '=')
+      return false;
+    while(*p == ' ')
+      p++;
+    const char * value = p;
+    if(*p == '"'){
+      value = ++p;
+      while(*p && *p != '"'){
+        if(*p == '\\' && p[1])
+          p++;
+        p++;
+      }
+      if(*p != '"')
+        return false;
+    } else {
+      while(*p && *p != ',' && *p != ' ')
+        p++;
+    }
+    size_t len = p - value;
+    if(*p == '"')
+      p++;
+    for(uint8_t i = 0; i < DIGEST_FIELDS; i++){
+      if(strlen(digestFieldNames[i]) == nameLen && !strncmp(digestFieldNames[i], name, nameLen)){
+        fields[i].value = value;
+        fields[i].len = len;
+        break;
+      }
+    }
+  }
+}
+
+static bool digestEquals(const DigestField& f, const char * s){
+  return f.value != NULL && strlen(s) == f.len && !memcmp(f.value, s, f.len);
+}
+
+bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri, bool * stale){
+  if(stale != NULL)
+    *stale = false;
   if(username == NULL || password == NULL || header == NULL || method == NULL){
     //os_printf("AUTH FAIL: missing requred fields\n");
     return false;
   }
 
-  String myHeader = String(header);
-  int nextBreak = myHeader.indexOf(",");
-  if(nextBreak < 0){
-    //os_printf("AUTH FAIL: no variables\n");
+  DigestField f[DIGEST_FIELDS];
+  if(!parseDigestHeader(header, f)){
+    //os_printf("AUTH FAIL: malformed header\n");
+    return false;
+  }
+  if(!f[DIGEST_NONCE].value || !f[DIGEST_URI].value || !f[DIGEST_RESPONSE].len || !f[DIGEST_CNONCE].value){
+    //os_printf("AUTH FAIL: missing variables\n");
+    return false;
+  }
+  if(!digestEquals(f[DIGEST_USERNAME], username)){
+    //os_printf("AUTH FAIL: username\n");
+    return false;
+  }
+  if(realm != NULL && !digestEquals(f[DIGEST_REALM], realm)){
+    //os_printf("AUTH FAIL: realm\n");
+    return false;
+  }
+  if(uri != NULL && !digestEquals(f[DIGEST_URI], uri)){
+    //os_printf("AUTH FAIL: uri\n");
     return false;
   }
+  //the challenge asks for qop=auth, without it the nonce count could not be checked
+  if(!digestEquals(f[DIGEST_QOP], "auth") || f[DIGEST_NC].len != 8){
+    //os_printf("AUTH FAIL: qop\n");
+    return false;
+  }
+  char ncText[9];
+  memcpy(ncText, f[DIGEST_NC].value, 8);
+  ncText[8] = 0;
+  char * ncEnd;
+  uint32_t nc = strtoul(ncText, &ncEnd, 16);
+  if(nc == 0 || ncEnd != ncText + 8)
+    return false;
 
-  String myUsername = String();
-  String myRealm = String();
-  String myNonce = String();
-  String myUri = String();
-  String myResponse = String();
-  String myQop = String();
-  String myNc = String();
-  String myCnonce = String();
-
-  myHeader += ", ";
-  do {
-    String avLine = myHeader.substring(0, nextBreak);
-    avLine.trim();
-    myHeader = myHeader.substring(nextBreak+1);
-    nextBreak = myHeader.indexOf(",");
-
-    int eqSign = avLine.indexOf("=");
-    if(eqSign < 0){
-      //os_printf("AUTH FAIL: no = sign\n");
+  DigestNonce * issued = NULL;
+  bool current = true;
+  if(nonce != NULL){
+    //the caller keeps its own nonces
+    if(!digestEquals(f[DIGEST_NONCE], nonce) || (opaque != NULL && !digestEquals(f[DIGEST_OPAQUE], opaque))){
+      //os_printf("AUTH FAIL: nonce\n");
       return false;
     }
-    String varName = avLine.substring(0, eqSign);
-    avLine = avLine.substring(eqSign + 1);
-    if(avLine.startsWith("\"")){
-      avLine = avLine.substring(1, avLine.length() - 1);
-    }
-
-    if(varName.equals(F("username"))){
-      if(!avLine.equals(username)){
-        //os_printf("AUTH FAIL: username\n");
-        return false;
+  } else {
+    uint32_t now = millis();
+    for(size_t i = 0; i < AWS_DIGEST_NONCES; i++){
+      if(!digestNonceExpired(digestNonces[i], now) && digestEquals(f[DIGEST_NONCE], digestNonces[i].nonce)){
+        issued = &digestNonces[i];
+        break;
       }
-      myUsername = avLine;
-    } else if(varName.equals(F("realm"))){
-      if(realm != NULL && !avLine.equals(realm)){
-        //os_printf("AUTH FAIL: realm\n");
-        return false;
-      }
-      myRealm = avLine;
-    } else if(varName.equals(F("nonce"))){
-      if(nonce != NULL && !avLine.equals(nonce)){
-        //os_printf("AUTH FAIL: nonce\n");
-        return false;
-      }
-      myNonce = avLine;
-    } else if(varName.equals(F("opaque"))){
-      if(opaque != NULL && !avLine.equals(opaque)){
-        //os_printf("AUTH FAIL: opaque\n");
-        return false;
-      }
-    } else if(varName.equals(F("uri"))){
-      if(uri != NULL && !avLine.equals(uri)){
-        //os_printf("AUTH FAIL: uri\n");
-        return false;
-      }
-      myUri = avLine;
-    } else if(varName.equals(F("response"))){
-      myResponse = avLine;
-    } else if(varName.equals(F("qop"))){
-      myQop = avLine;
-    } else if(varName.equals(F("nc"))){
-      myNc = avLine;
-    } else if(varName.equals(F("cnonce"))){
-      myCnonce = avLine;
     }
-  } while(nextBreak > 0);
+    //the response is still checked, right credentials with an old nonce get a new challenge marked stale
+    if(issued == NULL || !digestEquals(f[DIGEST_OPAQUE], issued->opaque)){
+      //os_printf("AUTH FAIL: unknown or expired nonce\n");
+      issued = NULL;
+      current = false;
+    } else if(!digestNonceFresh(*issued, nc)){
+      //os_printf("AUTH FAIL: replayed nonce count\n");
+      issued = NULL;
+      current = false;
+    }
+  }
 
-  String ha1 = (passwordIsHash) ? String(password) : stringMD5(myUsername + ":" + myRealm + ":" + String(password));
-  String ha2 = String(method) + ":" + myUri;
-  String response = ha1 + ":" + myNonce + ":" + myNc + ":" + myCnonce + ":" + myQop + ":" + stringMD5(ha2);
+  const char * ha1 = password;
+  if(!passwordIsHash)
+    ha1 = digestHA1(username, f[DIGEST_REALM].value ? f[DIGEST_REALM].value : "", f[DIGEST_REALM].len, password);
 
-  if(myResponse.equals(stringMD5(response))){
-    //os_printf("AUTH SUCCESS\n");
-    return true;
-  }
+  char ha2[33];
+  DigestMD5 md5;
+  md5Begin(&md5);
+  md5Add(&md5, method);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, f[DIGEST_URI].value, f[DIGEST_URI].len);
+  md5Hex(&md5, ha2);
 
-  //os_printf("AUTH FAIL: password\n");
-  return false;
+  char response[33];
+  md5Begin(&md5);
+  md5Add(&md5, ha1);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, f[DIGEST_NONCE].value, f[DIGEST_NONCE].len);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, f[DIGEST_NC].value, f[DIGEST_NC].len);
+  md5Add(&md5, ":", 1);
+  md5Add(&md5, f[DIGEST_CNONCE].value, f[DIGEST_CNONCE].len);
+  md5Add(&md5, ":auth:", 6);
+  md5Add(&md5, ha2, 32);
+  md5Hex(&md5, response);
+
+  if(!digestEquals(f[DIGEST_RESPONSE], response)){
+    //os_printf("AUTH FAIL: password\n");
+    return false;
+  }
+  if(!current){
+    if(stale != NULL)
+      *stale = true;
+    return false;
+  }
+  if(issued != NULL)
+    digestNonceUse(*issued, nc);
+  //os_printf("AUTH SUCCESS\n");
+  return true;
 }
@@ -24,9 +24,27 @@
 
 #include "Arduino.h"
 
+//digest nonces that are valid at the same time, the oldest is replaced by a new challenge
+#ifndef AWS_DIGEST_NONCES
+#define AWS_DIGEST_NONCES 8
+#endif
+
+//ms a digest nonce is accepted after it was handed out
+#ifndef AWS_DIGEST_NONCE_LIFETIME
+#define AWS_DIGEST_NONCE_LIFETIME 300000
+#endif
+
+//users whose md5(username:realm:password) is kept between requests
+#ifndef AWS_DIGEST_HA1_CACHE
+#define AWS_DIGEST_HA1_CACHE 4
+#endif
+
 bool checkBasicAuthentication(const char * header, const char * username, const char * password);
-String requestDigestAuthentication(const char * realm);
-bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri);
+//stale marks the challenge as the answer to right credentials with an old nonce, clients retry without asking the user
+String requestDigestAuthentication(const char * realm, bool stale=false);
+//nonce and opaque NULL check against the nonces of requestDigestAuthentication, each nonce count is accepted once.
+//stale is set when only the nonce was refused (expired, replaced or its count used)
+bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri, bool * stale=NULL);
 
 //for storing hashed versions on the device that can be authenticated against
 String generateDigestHash(const char * username, const char * password, const char * realm);
@@ -113,4 +113,14 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
     virtual bool isRequestHandlerTrivial() override final {return _onRequest ? false : true;}
 };
 
+//serves the metrics registry in the Prometheus text format, or as JSON with ?format=json
+class AsyncWebMetricsHandler: public AsyncWebHandler {
+  private:
+    String _url;
+  public:
+    AsyncWebMetricsHandler(const String& url="/metrics"): _url(url) {}
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+};
+
 #endif /* ASYNCWEBSERVERHANDLERIMPL_H_ */
@@ -95,6 +95,10 @@ bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request){
     if(_cache_control.length())
       request->addInterestingHeader(F("If-None-Match"));
 
+    // Processed templates of .gz files can be compressed again
+    if(_callback)
+      request->addInterestingHeader(F("Accept-Encoding"));
+
     DEBUGF("[AsyncStaticWebHandler::canHandle] TRUE\n");
     return true;
   }
@@ -128,7 +132,7 @@ bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request)
   return _fileExists(request, path);
 }
 
-#ifdef ESP32
+#if defined(ESP32) || defined(ASYNCWEBSERVER_HOST)
 #define FILE_IS_REAL(f) (f == true && !f.isDirectory())
 #else
 #define FILE_IS_REAL(f) (f == true)
@@ -32,6 +32,66 @@ static const String SharedEmptyString = String();
 
 enum { PARSE_REQ_START, PARSE_REQ_HEADERS, PARSE_REQ_BODY, PARSE_REQ_END, PARSE_REQ_FAIL };
 
+//freed body buffers kept for the next requests, so that bodies of similar size
+//do not fragment the heap. only touched from the network task
+#ifndef AWS_BODY_POOL_ENTRIES
+#define AWS_BODY_POOL_ENTRIES 2
+#endif
+
+//larger buffers go back to the heap
+#ifndef AWS_BODY_POOL_MAX
+#define AWS_BODY_POOL_MAX 4096
+#endif
+
+typedef struct {
+  uint8_t * data;
+  size_t capacity;
+} AsyncBodyBuffer;
+
+static AsyncBodyBuffer bodyPool[AWS_BODY_POOL_ENTRIES];
+
+static uint8_t * bodyPoolAcquire(size_t len, size_t *capacity){
+  AsyncBodyBuffer * best = NULL;
+  for(size_t i = 0; i < AWS_BODY_POOL_ENTRIES; i++){
+    AsyncBodyBuffer& b = bodyPool[i];
+    if(b.data != NULL && b.capacity >= len && (best == NULL || b.capacity < best->capacity))
+      best = &b;
+  }
+  if(best != NULL){
+    uint8_t * data = best->data;
+    *capacity = best->capacity;
+    best->data = NULL;
+    return data;
+  }
+  //small bodies get a common size so that their buffers can be reused
+  *capacity = (len < 512) ? 512 : len;
+  return (uint8_t *)malloc(*capacity);
+}
+
+static void bodyPoolRelease(uint8_t * data, size_t capacity){
+  if(capacity <= AWS_BODY_POOL_MAX){
+    AsyncBodyBuffer * slot = NULL;
+    for(size_t i = 0; i < AWS_BODY_POOL_ENTRIES; i++){
+      AsyncBodyBuffer& b = bodyPool[i];
+      if(b.data == NULL){
+        slot = &b;
+        break;
+      }
+      //keep the larger buffers, they serve more requests
+      if(b.capacity < capacity && (slot == NULL || b.capacity < slot->capacity))
+        slot = &b;
+    }
+    if(slot != NULL){
+      if(slot->data != NULL)
+        free(slot->data);
+      slot->data = data;
+      slot->capacity = capacity;
+      return;
+    }
+  }
+  free(data);
+}
+
 AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   : _client(c)
   , _server(s)
@@ -48,11 +108,16 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _authorization()
   , _reqconntype(RCT_HTTP)
   , _isDigest(false)
+  , _digestStale(false)
   , _isMultipart(false)
   , _isPlainPost(false)
   , _expectingContinue(false)
   , _contentLength(0)
   , _parsedLength(0)
+  , _parseStart(0)
+#if ASYNCWEBSERVER_TRACING
+  , _destroyed(NULL)
+#endif
   , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
   , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
   , _multiParseState(0)
@@ -66,6 +131,9 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _itemBuffer(0)
   , _itemBufferIndex(0)
   , _itemIsFile(false)
+  , _body(NULL)
+  , _bodyLength(0)
+  , _bodyCapacity(0)
   , _tempObject(NULL)
 {
   c->onError([](void *r, AsyncClient* c, int8_t error){ AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onError(error); }, this);
@@ -77,6 +145,13 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
 }
 
 AsyncWebServerRequest::~AsyncWebServerRequest(){
+#if ASYNCWEBSERVER_TRACING
+  if(_destroyed != NULL)
+    *_destroyed = true;
+  if(_response != NULL && _response->_finished())
+    AWS_TRACE(TRACE_LAST_ACK);
+  AsyncWebTracer::Instance()._record(_trace, _handler, _method, _url);
+#endif
   _headers.free();
 
   _params.free();
@@ -91,12 +166,20 @@ AsyncWebServerRequest::~AsyncWebServerRequest(){
     free(_tempObject);
   }
 
+  if(_body != NULL){
+    bodyPoolRelease(_body, _bodyCapacity);
+  }
+
   if(_tempFile){
     _tempFile.close();
   }
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len){
+  AWS_METRIC(httpBytesReceived.inc(len));
+  AWS_TRACE(TRACE_FIRST_BYTE);
+  if(_parseState == PARSE_REQ_START && !_temp.length())
+    _parseStart = micros();
   size_t i = 0;
   while (true) {
 
@@ -168,8 +251,7 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
     if(_parsedLength == _contentLength){
       _parseState = PARSE_REQ_END;
       //check if authenticated before calling handleRequest and request auth instead
-      if(_handler) _handler->handleRequest(this);
-      else send(501);
+      _handleRequest();
     }
   }
   break;
@@ -178,22 +260,32 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
 
 void AsyncWebServerRequest::_removeNotInterestingHeaders(){
   if (_interestingHeaders.containsIgnoreCase("ANY")) return; // nothing to do
-  for(const auto& header: _headers){
-      if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
-        _headers.remove(header);
-      }
-  }
+  //removing while iterating would advance from a freed node
+  while(_headers.remove_first([this](AsyncWebHeader *h){ return !_interestingHeaders.containsIgnoreCase(h->name().c_str()); }));
 }
 
 void AsyncWebServerRequest::_onPoll(){
   //os_printf("p\n");
+  //the request may be gone once the response or a job closed the connection
+  AsyncWebServer * server = _server;
   if(_response != NULL && _client != NULL && _client->canSend() && !_response->_finished()){
     _response->_ack(this, 0, 0);
   }
+  server->scheduler().run();
+}
+
+void AsyncWebServerRequest::resume(){
+  _onPoll();
+}
+
+bool AsyncWebServerRequest::schedule(AwsJobFunction step){
+  return _server->scheduler().add(this, step);
 }
 
 void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
   //os_printf("a:%u:%u\n", len, time);
+  AWS_METRIC(httpBytesSent.inc(len));
+  AsyncWebServer * server = _server;
   if(_response != NULL){
     if(!_response->_finished()){
       _response->_ack(this, len, time);
@@ -201,8 +293,11 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
       AsyncWebServerResponse* r = _response;
       _response = NULL;
       delete r;
+      AWS_TRACE(TRACE_LAST_ACK);
     }
   }
+  //jobs move on with the traffic of any connection, not only with the polls
+  server->scheduler().run();
 }
 
 void AsyncWebServerRequest::_onError(int8_t error){
@@ -226,6 +321,25 @@ void AsyncWebServerRequest::_onDisconnect(){
   _server->_handleDisconnect(this);
 }
 
+bool AsyncWebServerRequest::bufferBody(const uint8_t *data, size_t len, size_t index, size_t total, size_t maxLength){
+  if(total > maxLength || index + len > total)
+    return false;
+  if(_body == NULL){
+    if(index != 0)
+      return false;
+    _body = bodyPoolAcquire(total + 1, &_bodyCapacity);
+    if(_body == NULL)
+      return false;
+    _bodyLength = 0;
+  } else if(index != _bodyLength){
+    return false;
+  }
+  memcpy(_body + index, data, len);
+  _bodyLength = index + len;
+  _body[_bodyLength] = 0;
+  return true;
+}
+
 void AsyncWebServerRequest::_addParam(AsyncWebParameter *p){
   _params.add(p);
 }
@@ -561,8 +675,11 @@ void AsyncWebServerRequest::_parseLine(){
   if(_parseState == PARSE_REQ_HEADERS){
     if(!_temp.length()){
       //end of headers
+      AWS_METRIC(httpParseTime.observe(micros() - _parseStart));
+      AWS_TRACE(TRACE_HEADERS);
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
+      AWS_TRACE(TRACE_HANDLER);
       _removeNotInterestingHeaders();
       if(_expectingContinue){
         const char * response = "HTTP/1.1 100 Continue\r\n\r\n";
@@ -573,13 +690,36 @@ void AsyncWebServerRequest::_parseLine(){
         _parseState = PARSE_REQ_BODY;
       } else {
         _parseState = PARSE_REQ_END;
-        if(_handler) _handler->handleRequest(this);
-        else send(501);
+        _handleRequest();
       }
     } else _parseReqHeader();
   }
 }
 
+void AsyncWebServerRequest::_handleRequest(){
+  AWS_METRIC(httpRequests.inc());
+  AsyncWebServer * server = _server;
+#if ASYNCWEBSERVER_METRICS
+  uint32_t start = micros();
+#endif
+#if ASYNCWEBSERVER_TRACING
+  bool destroyed = false;
+  _destroyed = &destroyed;
+#endif
+  if(_handler) _handler->handleRequest(this);
+  else send(501);
+  //the request may be gone already, only locals from here
+  AWS_METRIC(httpHandlerTime.observe(micros() - start));
+#if ASYNCWEBSERVER_TRACING
+  if(!destroyed){
+    _destroyed = NULL;
+    AWS_TRACE(TRACE_HANDLER_DONE);
+  }
+#endif
+  //a job the handler scheduled takes its first steps right away
+  server->scheduler().run();
+}
+
 size_t AsyncWebServerRequest::headers() const{
   return _headers.length();
 }
@@ -717,6 +857,7 @@ void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
   }
   else {
     _client->setRxTimeout(0);
+    AWS_TRACE(TRACE_FIRST_SEND);
     _response->_respond(this);
   }
 }
@@ -755,6 +896,10 @@ AsyncResponseStream * AsyncWebServerRequest::beginResponseStream(const String& c
   return new AsyncResponseStream(contentType, bufferSize);
 }
 
+AsyncChunkedResponseStream * AsyncWebServerRequest::beginChunkedResponseStream(const String& contentType, size_t bufferSize, AwsStreamWritableHandler onWritable){
+  return new AsyncChunkedResponseStream(contentType, bufferSize, onWritable);
+}
+
 AsyncWebServerResponse * AsyncWebServerRequest::beginResponse_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback){
   return new AsyncProgmemResponse(code, contentType, content, len, callback);
 }
@@ -763,6 +908,10 @@ AsyncWebServerResponse * AsyncWebServerRequest::beginResponse_P(int code, const
   return beginResponse_P(code, contentType, (const uint8_t *)content, strlen_P(content), callback);
 }
 
+AsyncWebServerResponse * AsyncWebServerRequest::beginTemplateResponse(AsyncWebTemplate * tpl, const String& contentType, AwsTemplateValueFunction values, bool knownLength){
+  return new AsyncTemplateResponse(200, contentType, tpl, values, knownLength);
+}
+
 void AsyncWebServerRequest::send(int code, const String& contentType, const String& content){
   send(beginResponse(code, contentType, content));
 }
@@ -799,6 +948,12 @@ void AsyncWebServerRequest::send_P(int code, const String& contentType, PGM_P co
   send(beginResponse_P(code, contentType, content, callback));
 }
 
+void AsyncWebServerRequest::sendTemplate(AsyncWebTemplate * tpl, const String& contentType, AwsTemplateValueFunction values, bool knownLength){
+  if(tpl != NULL){
+    send(beginTemplateResponse(tpl, contentType, values, knownLength));
+  } else send(404);
+}
+
 void AsyncWebServerRequest::redirect(const String& url){
   AsyncWebServerResponse * response = beginResponse(302);
   response->addHeader("Location",url);
@@ -808,7 +963,7 @@ void AsyncWebServerRequest::redirect(const String& url){
 bool AsyncWebServerRequest::authenticate(const char * username, const char * password, const char * realm, bool passwordIsHash){
   if(_authorization.length()){
     if(_isDigest)
-      return checkDigestAuthentication(_authorization.c_str(), methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL);
+      return checkDigestAuthentication(_authorization.c_str(), methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL, &_digestStale);
     else if(!passwordIsHash)
       return checkBasicAuthentication(_authorization.c_str(), username, password);
     else
@@ -833,7 +988,7 @@ bool AsyncWebServerRequest::authenticate(const char * hash){
       return false;
     String realm = hStr.substring(0, separator);
     hStr = hStr.substring(separator + 1);
-    return checkDigestAuthentication(_authorization.c_str(), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL);
+    return checkDigestAuthentication(_authorization.c_str(), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL, &_digestStale);
   }
 
   return (_authorization.equals(hash));
@@ -850,7 +1005,8 @@ void AsyncWebServerRequest::requestAuthentication(const char * realm, bool isDig
     r->addHeader("WWW-Authenticate", header);
   } else {
     String header = "Digest ";
-    header.concat(requestDigestAuthentication(realm));
+    //a failed authenticate() may have found only the nonce too old
+    header.concat(requestDigestAuthentication(realm, _digestStale));
     r->addHeader("WWW-Authenticate", header);
   }
   send(r);
@@ -39,43 +39,77 @@ class AsyncBasicResponse: public AsyncWebServerResponse {
     bool _sourceValid() const { return true; }
 };
 
+#ifndef TEMPLATE_CACHE_SIZE
+#define TEMPLATE_CACHE_SIZE 128
+#endif
+
+// Look-ahead and spilled data of template processing. Spans are pushed to and popped
+// from the front with at most two memcpy. The ring is allocated on first use with
+// TEMPLATE_CACHE_SIZE bytes and only grows when a long value spills over it.
+class AsyncResponseRing {
+  private:
+    uint8_t *_buf;
+    size_t _size;
+    size_t _head;
+    size_t _len;
+    bool _reserve(size_t len);
+  public:
+    AsyncResponseRing(): _buf(NULL), _size(0), _head(0), _len(0) {}
+    ~AsyncResponseRing(){ if(_buf) free(_buf); }
+    size_t length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    // the span goes before everything already queued. false if there is no memory for it
+    bool pushFront(const uint8_t *data, size_t len);
+    size_t popFront(uint8_t *data, size_t len);
+};
+
+// Processed templates of .gz files are compressed again for clients accepting gzip
+#ifndef TEMPLATE_GZIP_RECOMPRESS
+#define TEMPLATE_GZIP_RECOMPRESS 1
+#endif
+
+class AsyncWebDeflater;
+
 class AsyncAbstractResponse: public AsyncWebServerResponse {
   private:
     String _head;
-    // Data is inserted into cache at begin(). 
-    // This is inefficient with vector, but if we use some other container, 
-    // we won't be able to access it as contiguous array of bytes when reading from it,
-    // so by gaining performance in one place, we'll lose it in another.
-    std::vector<uint8_t> _cache;
+    AsyncResponseRing _cache;
+    AsyncWebDeflater *_deflater;
+    uint32_t _gzipCrc;
+    uint32_t _gzipSize;
+    uint8_t _gzipState;
     size_t _readDataFromCacheOrContent(uint8_t* data, const size_t len);
     size_t _fillBufferAndProcessTemplates(uint8_t* buf, size_t maxLen);
+    size_t _fillBufferAndCompress(uint8_t* buf, size_t maxLen);
   protected:
     AwsTemplateProcessor _callback;
+    // the content was inflated from gzip for template processing
+    bool _gzipTemplate;
   public:
     AsyncAbstractResponse(AwsTemplateProcessor callback=nullptr);
+    ~AsyncAbstractResponse();
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return false; }
     virtual size_t _fillBuffer(uint8_t *buf __attribute__((unused)), size_t maxLen __attribute__((unused))) { return 0; }
 };
 
-#ifndef TEMPLATE_PLACEHOLDER
-#define TEMPLATE_PLACEHOLDER '%'
-#endif
+class AsyncWebGzipInflater;
 
-#define TEMPLATE_PARAM_NAME_LENGTH 32
 class AsyncFileResponse: public AsyncAbstractResponse {
   using File = fs::File;
   using FS = fs::FS;
   private:
     File _content;
     String _path;
+    AsyncWebGzipInflater *_inflater;
     void _setContentType(const String& path);
+    void _setContentEncoding();
   public:
     AsyncFileResponse(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
     AsyncFileResponse(File content, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
     ~AsyncFileResponse();
-    bool _sourceValid() const { return !!(_content); }
+    bool _sourceValid() const;
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
 };
 
@@ -118,6 +152,47 @@ class AsyncProgmemResponse: public AsyncAbstractResponse {
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
 };
 
+//streams a compiled template, literals from its source and values from the callback by id.
+//with knownLength every value is taken before the headers so Content-Length can be sent
+class AsyncTemplateResponse: public AsyncAbstractResponse {
+  using File = fs::File;
+  private:
+    AsyncWebTemplate * _template;
+    AwsTemplateValueFunction _values;
+    std::vector<String> _known;
+    size_t _segment;
+    size_t _segmentPos;
+    size_t _placeholder;
+    String _value;
+    bool _valueReady;
+    File _file;
+    size_t _filePos;
+    size_t _readLiteral(uint8_t *data, size_t offset, size_t len);
+  public:
+    AsyncTemplateResponse(int code, const String& contentType, AsyncWebTemplate * tpl, AwsTemplateValueFunction values, bool knownLength=false);
+    ~AsyncTemplateResponse();
+    void _respond(AsyncWebServerRequest *request);
+    bool _sourceValid() const;
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+};
+
+//streams the metrics registry line by line into the send buffer, nothing is allocated per metric.
+//metrics must not be removed while a response is being sent
+class AsyncWebMetricsResponse: public AsyncAbstractResponse {
+  private:
+    bool _json;
+    AsyncWebMetric * _metric;
+    size_t _step;
+    char _line[AWS_METRICS_LINE_LENGTH];
+    size_t _lineLen;
+    size_t _linePos;
+    bool _nextLine();
+  public:
+    AsyncWebMetricsResponse(bool json=false);
+    bool _sourceValid() const { return true; }
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+};
+
 class cbuf;
 
 class AsyncResponseStream: public AsyncAbstractResponse, public Print {
@@ -133,4 +208,32 @@ class AsyncResponseStream: public AsyncAbstractResponse, public Print {
     using Print::write;
 };
 
+//a body written while it is sent. the buffer does not grow, writes take what fits and the
+//producer gets room again when the client acknowledges data. memory stays at bufferSize
+//whatever the size of the body. network task only
+class AsyncChunkedResponseStream: public AsyncAbstractResponse, public Print {
+  private:
+    cbuf *_content;
+    AwsStreamWritableHandler _onWritable;
+    AsyncWebServerRequest *_request;
+    bool _ended;
+    bool _waiting;          //the last fill found nothing to send
+    void _kick();
+  public:
+    AsyncChunkedResponseStream(const String& contentType, size_t bufferSize, AwsStreamWritableHandler onWritable=nullptr);
+    ~AsyncChunkedResponseStream();
+    bool _sourceValid() const { return _content != NULL; }
+    virtual void _respond(AsyncWebServerRequest *request) override;
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+    //bytes that can be written now
+    size_t room() const;
+    //no more writes, the response completes once the buffer is sent
+    void end();
+    bool ended() const { return _ended; }
+    //returns the bytes taken, less than len when the buffer is full
+    size_t write(const uint8_t *data, size_t len);
+    size_t write(uint8_t data);
+    using Print::write;
+};
+
 #endif /* ASYNCWEBSERVERRESPONSEIMPL_H_ */
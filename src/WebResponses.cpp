@@ -20,6 +20,7 @@
 */
 #include "ESPAsyncWebServer.h"
 #include "WebResponseImpl.h"
+#include "AsyncWebDeflate.h"
 #include "cbuf.h"
 
 // Since ESP8266 does not link memchr by default, here's its implementation.
@@ -138,8 +139,8 @@ String AsyncWebServerResponse::_assembleHead(uint8_t version){
   out.concat(buf);
 
   if(_sendContentLength) {
-    static const char _cnt[] PROGMEM = "Content-Length: %d\r\n";
-    snprintf(buf, bufSize, reinterpret_cast<const char*>(_cnt), _contentLength);
+    static const char _cnt[] PROGMEM = "Content-Length: %u\r\n";
+    snprintf(buf, bufSize, reinterpret_cast<const char*>(_cnt), (unsigned)_contentLength);
     out.concat(buf);
   }
   if(_contentType.length()) {
@@ -246,7 +247,17 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
  * Abstract Response
  * */
 
-AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
+#define GZIP_OUT_HEADER 0
+#define GZIP_OUT_BODY 1
+#define GZIP_OUT_DONE 2
+
+AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback)
+  : _deflater(NULL)
+  , _gzipCrc(0)
+  , _gzipSize(0)
+  , _gzipState(GZIP_OUT_HEADER)
+  , _callback(callback)
+  , _gzipTemplate(false)
 {
   // In case of template processing, we're unable to determine real response size
   if(callback) {
@@ -256,8 +267,25 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _ca
   }
 }
 
+AsyncAbstractResponse::~AsyncAbstractResponse(){
+  if(_deflater)
+    delete _deflater;
+}
+
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request){
   addHeader(F("Connection"),F("close"));
+#if TEMPLATE_GZIP_RECOMPRESS
+  if(_gzipTemplate && _callback){
+    addHeader(F("Vary"), F("Accept-Encoding"));
+    AsyncWebHeader* accept = request->getHeader(F("Accept-Encoding"));
+    if(accept && accept->value().indexOf(F("gzip")) >= 0){
+      // every chunk is compressed on its own, no history window is kept
+      _deflater = new AsyncWebDeflater(15, true);
+      if(_deflater)
+        addHeader(F("Content-Encoding"), F("gzip"));
+    }
+  }
+#endif
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -275,7 +303,8 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
   size_t headLen = _head.length();
   if(_state == RESPONSE_HEADERS){
     if(space >= headLen){
-      _state = RESPONSE_CONTENT;
+      //the headers go out with the first body bytes. the state stays until they are written,
+      //a fill that has to wait (RESPONSE_TRY_AGAIN) leaves them for the next call
       space -= headLen;
     } else {
       String out = _head.substring(0, space);
@@ -285,7 +314,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     }
   }
 
-  if(_state == RESPONSE_CONTENT){
+  if(_state == RESPONSE_HEADERS || _state == RESPONSE_CONTENT){
     size_t outLen;
     if(_chunked){
       if(space <= 8){
@@ -313,12 +342,12 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     if(_chunked){
       // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
       // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf+headLen+6, outLen - 8);
+      readLen = _fillBufferAndCompress(buf+headLen+6, outLen - 8);
       if(readLen == RESPONSE_TRY_AGAIN){
           free(buf);
           return 0;
       }
-      outLen = sprintf((char*)buf+headLen, "%x", readLen) + headLen;
+      outLen = sprintf((char*)buf+headLen, "%x", (unsigned)readLen) + headLen;
       while(outLen < headLen + 4) buf[outLen++] = ' ';
       buf[outLen++] = '\r';
       buf[outLen++] = '\n';
@@ -326,7 +355,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       buf[outLen++] = '\r';
       buf[outLen++] = '\n';
     } else {
-      readLen = _fillBufferAndProcessTemplates(buf+headLen, outLen);
+      readLen = _fillBufferAndCompress(buf+headLen, outLen);
       if(readLen == RESPONSE_TRY_AGAIN){
           free(buf);
           return 0;
@@ -337,6 +366,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     if(headLen){
         _head = String();
     }
+    _state = RESPONSE_CONTENT;
 
     if(outLen){
         _writtenLength += request->client()->write((const char*)buf, outLen);
@@ -350,7 +380,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 
     free(buf);
 
-    if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength)){
+    if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sendContentLength && _sentLength == _contentLength)){
       _state = RESPONSE_WAIT_ACK;
     }
     return outLen;
@@ -365,20 +395,132 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
   return 0;
 }
 
+/*
+ * Template look-ahead ring
+ * */
+
+bool AsyncResponseRing::_reserve(size_t len){
+  if(_size - _len >= len)
+    return true;
+  size_t size = _size ? _size : TEMPLATE_CACHE_SIZE;
+  while(size - _len < len)
+    size <<= 1;
+  uint8_t *buf = (uint8_t*)malloc(size);
+  if(!buf)
+    return false;
+  // the new ring starts unwrapped
+  if(_len){
+    const size_t first = std::min(_len, _size - _head);
+    memcpy(buf, _buf + _head, first);
+    memcpy(buf + first, _buf, _len - first);
+  }
+  if(_buf)
+    free(_buf);
+  _buf = buf;
+  _size = size;
+  _head = 0;
+  return true;
+}
+
+bool AsyncResponseRing::pushFront(const uint8_t *data, size_t len){
+  if(!len)
+    return true;
+  if(!_reserve(len))
+    return false;
+  _head = (_head + _size - len) % _size;
+  const size_t first = std::min(len, _size - _head);
+  memcpy(_buf + _head, data, first);
+  memcpy(_buf, data + first, len - first);
+  _len += len;
+  return true;
+}
+
+size_t AsyncResponseRing::popFront(uint8_t *data, size_t len){
+  const size_t out = std::min(len, _len);
+  if(!out)
+    return 0;
+  const size_t first = std::min(out, _size - _head);
+  memcpy(data, _buf + _head, first);
+  memcpy(data + first, _buf, out - first);
+  _head = (_head + out) % _size;
+  _len -= out;
+  return out;
+}
+
 size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t* data, const size_t len)
 {
     // If we have something in cache, copy it to buffer
-    const size_t readFromCache = std::min(len, _cache.size());
-    if(readFromCache) {
-      memcpy(data, _cache.data(), readFromCache);
-      _cache.erase(_cache.begin(), _cache.begin() + readFromCache);
-    }
+    const size_t readFromCache = _cache.popFront(data, len);
     // If we need to read more...
     const size_t needFromFile = len - readFromCache;
     const size_t readFromContent = _fillBuffer(data + readFromCache, needFromFile);
     return readFromCache + readFromContent;
 }
 
+size_t AsyncAbstractResponse::_fillBufferAndCompress(uint8_t* data, size_t len)
+{
+  if(!_deflater)
+    return _fillBufferAndProcessTemplates(data, len);
+  if(_gzipState == GZIP_OUT_DONE)
+    return 0;
+  // leave room for the gzip header, the block framing and the trailer
+  if(len < 64)
+    return RESPONSE_TRY_AGAIN;
+
+  size_t out = (_gzipState == GZIP_OUT_HEADER) ? 10 : 0;
+  // fixed huffman codes take at most 9 bits for a byte
+  const size_t plainCap = (len - out - 16) * 8 / 9;
+  uint8_t* plain = (uint8_t*)malloc(plainCap);
+  if(!plain)
+    return RESPONSE_TRY_AGAIN;
+  const size_t plainLen = _fillBufferAndProcessTemplates(plain, plainCap);
+  if(plainLen == RESPONSE_TRY_AGAIN){
+    free(plain);
+    return RESPONSE_TRY_AGAIN;
+  }
+
+  if(_gzipState == GZIP_OUT_HEADER){
+    // deflate, no flags, no time, unknown OS
+    static const uint8_t header[10] = { 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF };
+    memcpy(data, header, sizeof(header));
+    _gzipState = GZIP_OUT_BODY;
+  }
+
+  if(plainLen){
+    _gzipCrc = gzipCrc32(_gzipCrc, plain, plainLen);
+    _gzipSize += plainLen;
+    size_t packed = _deflater->compress(plain, plainLen, data + out, len - out - 4);
+    if(packed){
+      // the compressor strips the empty stored block that ends the chunk
+      out += packed;
+      data[out++] = 0x00;
+      data[out++] = 0x00;
+      data[out++] = 0xFF;
+      data[out++] = 0xFF;
+    } else {
+      // no memory for the match finder, store the chunk as it is
+      data[out++] = 0x00;
+      data[out++] = plainLen & 0xFF;
+      data[out++] = (plainLen >> 8) & 0xFF;
+      data[out++] = ~plainLen & 0xFF;
+      data[out++] = (~plainLen >> 8) & 0xFF;
+      memcpy(data + out, plain, plainLen);
+      out += plainLen;
+    }
+  } else {
+    // final empty block, crc and size of the processed output
+    data[out++] = 0x03;
+    data[out++] = 0x00;
+    for(uint8_t i = 0; i < 4; i++)
+      data[out++] = (_gzipCrc >> (8 * i)) & 0xFF;
+    for(uint8_t i = 0; i < 4; i++)
+      data[out++] = (_gzipSize >> (8 * i)) & 0xFF;
+    _gzipState = GZIP_OUT_DONE;
+  }
+  free(plain);
+  return out;
+}
+
 size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size_t len)
 {
   if(!_callback)
@@ -394,10 +536,12 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
     // temporary buffer to hold parameter name
     uint8_t buf[TEMPLATE_PARAM_NAME_LENGTH + 1];
     String paramName;
+    // the placeholder ends in read-ahead data, not in the buffer
+    bool paramSplit = false;
     // If closing placeholder is found:
     if(pTemplateEnd) {
       // prepare argument to callback
-      const size_t paramNameLength = std::min(sizeof(buf) - 1, (unsigned int)(pTemplateEnd - pTemplateStart - 1));
+      const size_t paramNameLength = std::min(sizeof(buf) - 1, (size_t)(pTemplateEnd - pTemplateStart - 1));
       if(paramNameLength) {
         memcpy(buf, pTemplateStart + 1, paramNameLength);
         buf[paramNameLength] = 0;
@@ -418,13 +562,17 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
           *pTemplateEnd = 0;
           paramName = String(reinterpret_cast<char*>(buf));
           // Copy remaining read-ahead data into cache
-          _cache.insert(_cache.begin(), pTemplateEnd + 1, buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
+          _cache.pushFront(pTemplateEnd + 1, buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent - pTemplateEnd - 1);
           pTemplateEnd = &data[len - 1];
+          paramSplit = true;
+          // escaped percent sign split over the buffer end, the 2nd one is consumed already
+          if(!paramName.length())
+            ++pTemplateStart;
         }
         else // closing placeholder not found in file data, store found percent symbol as is and advance to the next position
         {
           // but first, store read file data in cache
-          _cache.insert(_cache.begin(), buf + (&data[len - 1] - pTemplateStart), buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
+          _cache.pushFront(buf + (&data[len - 1] - pTemplateStart), readFromCacheOrContent);
           ++pTemplateStart;
         }
       }
@@ -440,13 +588,27 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
       // The first byte of data after placeholder is located at pTemplateEnd + 1.
       // It should be located at pTemplateStart + numBytesCopied (to begin right after inserted parameter value).
       const String paramValue(_callback(paramName));
+      if(paramValue == TEMPLATE_PENDING) {
+        // keep the placeholder and everything after it for the next call, the value is asked again then
+        _cache.pushFront(pTemplateEnd + 1, &data[len] - pTemplateEnd - 1);
+        if(paramSplit) {
+          String placeholder((char)TEMPLATE_PLACEHOLDER);
+          placeholder += paramName;
+          placeholder += (char)TEMPLATE_PLACEHOLDER;
+          _cache.pushFront((const uint8_t*)placeholder.c_str(), placeholder.length());
+        } else {
+          _cache.pushFront(pTemplateStart, pTemplateEnd + 1 - pTemplateStart);
+        }
+        // nothing rendered yet is not the end of the content
+        return (pTemplateStart > data) ? (size_t)(pTemplateStart - data) : RESPONSE_TRY_AGAIN;
+      }
       const char* pvstr = paramValue.c_str();
       const unsigned int pvlen = paramValue.length();
       const size_t numBytesCopied = std::min(pvlen, static_cast<unsigned int>(&data[originalLen - 1] - pTemplateStart + 1));
       // make room for param value
       // 1. move extra data to cache if parameter value is longer than placeholder AND if there is no room to store
       if((pTemplateEnd + 1 < pTemplateStart + numBytesCopied) && (originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1) < len)) {
-        _cache.insert(_cache.begin(), &data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)], &data[len]);
+        _cache.pushFront(&data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)], len - originalLen + (pTemplateStart + numBytesCopied - pTemplateEnd - 1));
         //2. parameter value is longer than placeholder text, push the data after placeholder which not saved into cache further to the end
         memmove(pTemplateStart + numBytesCopied, pTemplateEnd + 1, &data[originalLen] - pTemplateStart - numBytesCopied);
       } else if(pTemplateEnd + 1 != pTemplateStart + numBytesCopied)
@@ -455,9 +617,11 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
         memmove(pTemplateStart + numBytesCopied, pTemplateEnd + 1, &data[len] - pTemplateEnd - 1);
       // 3. replace placeholder with actual value
       memcpy(pTemplateStart, pvstr, numBytesCopied);
-      // If result is longer than buffer, copy the remainder into cache (this could happen only if placeholder text itself did not fit entirely in buffer)
+      // If result is longer than the room left in buffer, copy the remainder into cache
       if(numBytesCopied < pvlen) {
-        _cache.insert(_cache.begin(), pvstr + numBytesCopied, pvstr + pvlen);
+        _cache.pushFront((const uint8_t*)pvstr + numBytesCopied, pvlen - numBytesCopied);
+        // the value runs up to the end of the buffer
+        len = originalLen;
       } else if(pTemplateStart + numBytesCopied < pTemplateEnd + 1) { // result is copied fully; if result is shorter than placeholder text...
         // there is some free room, fill it from cache
         const size_t roomFreed = pTemplateEnd + 1 - pTemplateStart - numBytesCopied;
@@ -478,10 +642,39 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
  * */
 
 AsyncFileResponse::~AsyncFileResponse(){
+  if(_inflater)
+    delete _inflater;
   if(_content)
     _content.close();
 }
 
+bool AsyncFileResponse::_sourceValid() const {
+  return !!(_content) && !(_inflater && _inflater->failed());
+}
+
+void AsyncFileResponse::_setContentEncoding(){
+  if(_callback){
+    // templates are processed on the inflated text
+    _inflater = new AsyncWebGzipInflater(&_content);
+    if(_inflater && _inflater->begin()){
+      _gzipTemplate = true;
+      return;
+    }
+    // no memory for the window, the file is sent compressed and unprocessed as before
+    if(_inflater)
+      delete _inflater;
+    _inflater = NULL;
+    _callback = nullptr;
+    if(!_content.seek(0)){
+      _content.close();
+      return;
+    }
+  }
+  addHeader(F("Content-Encoding"), F("gzip"));
+  _sendContentLength = true;
+  _chunked = false;
+}
+
 void AsyncFileResponse::_setContentType(const String& path){
   if (path.endsWith(F(".html"))) _contentType = F("text/html");
   else if (path.endsWith(F(".htm"))) _contentType = F("text/html");
@@ -504,20 +697,20 @@ void AsyncFileResponse::_setContentType(const String& path){
   else _contentType = F("text/plain");
 }
 
-AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& contentType, bool download, AwsTemplateProcessor callback): AsyncAbstractResponse(callback){
+AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& contentType, bool download, AwsTemplateProcessor callback): AsyncAbstractResponse(callback), _inflater(NULL){
   _code = 200;
   _path = path;
 
+  bool gzip = false;
   if(!download && !fs.exists(_path) && fs.exists(_path+".gz")){
     _path = _path+".gz";
-    addHeader(F("Content-Encoding"), F("gzip"));
-    _callback = nullptr; // Unable to process zipped templates
-    _sendContentLength = true;
-    _chunked = false;
+    gzip = true;
   }
 
   _content = fs.open(_path, "r");
   _contentLength = _content.size();
+  if(gzip && _content)
+    _setContentEncoding();
 
   if(contentType == "")
     _setContentType(path);
@@ -538,19 +731,14 @@ AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& c
   addHeader(F("Content-Disposition"), buf);
 }
 
-AsyncFileResponse::AsyncFileResponse(File content, const String& path, const String& contentType, bool download, AwsTemplateProcessor callback): AsyncAbstractResponse(callback){
+AsyncFileResponse::AsyncFileResponse(File content, const String& path, const String& contentType, bool download, AwsTemplateProcessor callback): AsyncAbstractResponse(callback), _inflater(NULL){
   _code = 200;
   _path = path;
 
-  if(!download && String(content.name()).endsWith(".gz") && !path.endsWith(".gz")){
-    addHeader(F("Content-Encoding"), F("gzip"));
-    _callback = nullptr; // Unable to process gzipped templates
-    _sendContentLength = true;
-    _chunked = false;
-  }
-
   _content = content;
   _contentLength = _content.size();
+  if(!download && String(content.name()).endsWith(".gz") && !path.endsWith(".gz"))
+    _setContentEncoding();
 
   if(contentType == "")
     _setContentType(path);
@@ -570,6 +758,8 @@ AsyncFileResponse::AsyncFileResponse(File content, const String& path, const Str
 }
 
 size_t AsyncFileResponse::_fillBuffer(uint8_t *data, size_t len){
+  if(_inflater)
+    return _inflater->read(data, len);
   return _content.read(data, len);
 }
 
@@ -697,3 +887,84 @@ size_t AsyncResponseStream::write(const uint8_t *data, size_t len){
 size_t AsyncResponseStream::write(uint8_t data){
   return write(&data, 1);
 }
+
+/*
+ * Chunked Response Stream (Bounded buffer, written while sending)
+ * */
+
+AsyncChunkedResponseStream::AsyncChunkedResponseStream(const String& contentType, size_t bufferSize, AwsStreamWritableHandler onWritable)
+  : _onWritable(onWritable)
+  , _request(NULL)
+  , _ended(false)
+  , _waiting(false)
+{
+  _code = 200;
+  _contentLength = 0;
+  _contentType = contentType;
+  _sendContentLength = false;
+  _chunked = true;
+  _content = new cbuf(bufferSize);
+}
+
+AsyncChunkedResponseStream::~AsyncChunkedResponseStream(){
+  delete _content;
+}
+
+void AsyncChunkedResponseStream::_respond(AsyncWebServerRequest *request){
+  //HTTP/1.0 has no chunks, the end of the body is the end of the connection
+  if(!request->version())
+    _chunked = false;
+  _request = request;
+  AsyncAbstractResponse::_respond(request);
+}
+
+//sends what was written while the response waited for data, instead of leaving it for the next poll
+void AsyncChunkedResponseStream::_kick(){
+  if(!_waiting || _request == NULL)
+    return;
+  _waiting = false;
+  if(_request->client()->canSend())
+    _ack(_request, 0, 0);
+}
+
+void AsyncChunkedResponseStream::end(){
+  if(_ended)
+    return;
+  _ended = true;
+  _kick();
+}
+
+size_t AsyncChunkedResponseStream::room() const {
+  return (_content == NULL || _ended) ? 0 : _content->room();
+}
+
+size_t AsyncChunkedResponseStream::_fillBuffer(uint8_t *buf, size_t maxLen){
+  _waiting = false;
+  size_t len = _content->read((char*)buf, maxLen);
+  //the producer refills what was just taken, it goes out with this packet if there is space left
+  if(_onWritable && room()){
+    _onWritable(this, room());
+    if(len < maxLen)
+      len += _content->read((char*)buf + len, maxLen - len);
+  }
+  if(len)
+    return len;
+  //an empty chunk would end the body, wait for the producer instead
+  if(_ended)
+    return 0;
+  _waiting = true;
+  return RESPONSE_TRY_AGAIN;
+}
+
+size_t AsyncChunkedResponseStream::write(const uint8_t *data, size_t len){
+  if(_content == NULL || _ended || _finished())
+    return 0;
+  size_t written = _content->write((const char*)data, std::min(len, _content->room()));
+  if(written)
+    _kick();
+  return written;
+}
+
+size_t AsyncChunkedResponseStream::write(uint8_t data){
+  return write(&data, 1);
+}
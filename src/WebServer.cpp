@@ -21,6 +21,16 @@
 #include "ESPAsyncWebServer.h"
 #include "WebHandlerImpl.h"
 
+#ifdef ASYNCWEBSERVER_HOST
+//a host has no soft AP, every request comes in as a station
+bool ON_STA_FILTER(AsyncWebServerRequest *request __attribute__((unused))) {
+  return true;
+}
+
+bool ON_AP_FILTER(AsyncWebServerRequest *request __attribute__((unused))) {
+  return false;
+}
+#else
 bool ON_STA_FILTER(AsyncWebServerRequest *request) {
   return WiFi.localIP() == request->client()->localIP();
 }
@@ -28,6 +38,7 @@ bool ON_STA_FILTER(AsyncWebServerRequest *request) {
 bool ON_AP_FILTER(AsyncWebServerRequest *request) {
   return WiFi.localIP() != request->client()->localIP();
 }
+#endif
 
 
 AsyncWebServer::AsyncWebServer(uint16_t port)
@@ -44,10 +55,13 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
     c->setRxTimeout(3);
     AsyncWebServerRequest *r = new AsyncWebServerRequest((AsyncWebServer*)s, c);
     if(r == NULL){
+      AWS_METRIC(httpRejected.inc());
       c->close(true);
       c->free();
       delete c;
+      return;
     }
+    AWS_METRIC(httpConnections.inc());
   }, this);
 }
 
@@ -99,6 +113,7 @@ void AsyncWebServer::beginSecure(const char *cert, const char *key, const char *
 #endif
 
 void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request){
+  _scheduler.cancel(request);
   delete request;
 }
 